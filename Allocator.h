@@ -11,19 +11,237 @@
 // includes
 // --------
 
+#include <algorithm> // fill, sort
 #include <cassert>   // assert
 #include <cstddef>   // ptrdiff_t, size_t
+#include <functional> // less
+#include <iomanip>   // setw
 #include <new>       // bad_alloc, new
+#include <ostream>   // ostream
 #include <stdexcept> // invalid_argument
 #include <string>
 #include "gtest/gtest_prod.h"
 
+// ---------
+// placement
+// ---------
+
+/**
+ * walks every block from index 0 and takes the first free block that fits
+ */
+struct first_fit {};
+
+/**
+ * keeps free blocks on power-of-two size-class lists
+ * the next and prev links live in the first two ints of the free payload
+ */
+struct segregated_fit {};
+
+/**
+ * like first_fit, but each search starts where the last allocation left off and wraps around
+ */
+struct next_fit {};
+
+/**
+ * takes the smallest free block that fits, stopping at an exact fit or once L blocks, allocated or
+ * free, have been looked at and one of them fits
+ * L = 0 looks at every block
+ */
+template <int L = 0>
+struct best_fit {};
+
+/**
+ * carves the arena into equal single-object slots with an intrusive free stack
+ * selects the Allocator<T, N, fixed_pool> specialization below
+ */
+struct fixed_pool {};
+
+/**
+ * hands out blocks by bumping an index, frees them all at once with reset()
+ * selects the Allocator<T, N, monotonic> specialization below
+ */
+struct monotonic {};
+
+// -----------
+// check_level
+// -----------
+
+/**
+ * how much of the heap each operation checks, only while asserts are enabled
+ * check_none:  nothing
+ * check_local: the sentinels of the block that was touched and of its two neighbours
+ * check_full:  valid(), a walk of the whole arena
+ * check_heap() always runs the full walk, whatever the level
+ * the level never changes what deallocate checks about its pointer, that's always done
+ * (deallocate_trusted() is the explicit way to skip most of it)
+ */
+enum check_level {
+    check_none,
+    check_local,
+    check_full};
+
+#ifndef ALLOCATOR_CHECK_LEVEL
+#define ALLOCATOR_CHECK_LEVEL check_full
+#endif
+
+// ---------------
+// allocator_stats
+// ---------------
+
+/**
+ * 1 turns on the event counters in allocator_stats, 0 compiles them out
+ * the fields that come from walking the heap are there either way
+ */
+#ifndef ALLOCATOR_STATS
+#define ALLOCATOR_STATS 0
+#endif
+
+/**
+ * the number of request-size classes, class c holds requests of [2^c, 2^(c+1)) bytes
+ */
+const int allocator_sizes = 32;
+
+/**
+ * a snapshot of an Allocator, from stats()
+ * the counters are since construction and stay 0 unless ALLOCATOR_STATS is 1
+ * the rest comes from a walk of the heap
+ * bytes_live + bytes_free + bytes_sentinel is the part of the arena that holds blocks
+ */
+struct allocator_stats {
+    std::size_t allocations;       // blocks handed out, batches count each block
+    std::size_t deallocations;     // blocks given back
+    std::size_t failures;          // requests that threw bad_alloc
+    std::size_t searches;          // calls to the placement's search
+    std::size_t scanned;           // blocks those searches looked at
+    std::size_t max_scanned;       // blocks the longest single search looked at
+    std::size_t coalesced_back;    // frees that merged with only the block behind
+    std::size_t coalesced_front;   // frees that merged with only the block in front
+    std::size_t coalesced_both;    // frees that merged with both
+    std::size_t sizes[allocator_sizes]; // requests by size class of their bytes
+
+    std::size_t blocks;
+    std::size_t free_blocks;
+    std::size_t bytes_live;        // payloads of allocated blocks, round-up included
+    std::size_t bytes_free;        // payloads of free blocks
+    std::size_t bytes_sentinel;    // two sentinels per block
+    std::size_t largest_free;      // the biggest payload one allocate could get
+    double      fragmentation;     // 1 - largest_free / bytes_free, 0 with nothing free
+};
+
+// ------------------
+// allocator_counters
+// ------------------
+
+/**
+ * the event counters behind allocator_stats
+ * with S false every hook is empty and the empty base costs nothing
+ */
+template <bool S>
+struct allocator_counters {
+    void allocated   (std::size_t, std::size_t) {}
+    void failed      ()                          {}
+    void deallocated (std::size_t)               {}
+    void scan        () const                    {}
+    void searched    ()                          {}
+    void coalesced   (bool, bool)                {}
+    void counts      (allocator_stats& r) const {
+        r = allocator_stats();}};
+
+/**
+ * scanning is mutable so the const searches can count the blocks they look at
+ */
+template <>
+struct allocator_counters<true> {
+    allocator_stats     c;
+    mutable std::size_t scanning; // blocks the current search has looked at
+
+    allocator_counters () :
+            c        (),
+            scanning (0)
+        {}
+
+    /**
+     * k blocks of b bytes each
+     */
+    void allocated (std::size_t b, std::size_t k) {
+        const int s = b == 0 ? 0 : 63 - __builtin_clzll(b);
+        c.allocations += k;
+        c.sizes[s < allocator_sizes ? s : allocator_sizes - 1] += k;}
+
+    void failed () {
+        ++c.failures;}
+
+    void deallocated (std::size_t k) {
+        c.deallocations += k;}
+
+    void scan () const {
+        ++scanning;}
+
+    void searched () {
+        ++c.searches;
+        c.scanned += scanning;
+        if (scanning > c.max_scanned) {
+            c.max_scanned = scanning;}
+        scanning = 0;}
+
+    void coalesced (bool back, bool front) {
+        if (back && front) {
+            ++c.coalesced_both;}
+        else if (back) {
+            ++c.coalesced_back;}
+        else if (front) {
+            ++c.coalesced_front;}}
+
+    void counts (allocator_stats& r) const {
+        r = c;}};
+
+// -------------
+// allocator_log
+// -------------
+
+/**
+ * O(1) in space
+ * O(log n) in time
+ * floor of log2(n), used to size the segregated free lists at compile time
+ */
+constexpr int allocator_log (std::size_t n) {
+    return n < 2 ? 0 : 1 + allocator_log(n / 2);}
+
+// -------------------
+// allocator_placement
+// -------------------
+
+/**
+ * what a placement policy keeps besides the arena
+ * first_fit and best_fit keep nothing, the empty base costs nothing
+ */
+template <typename P, int B>
+struct allocator_placement {};
+
+/**
+ * head[c] is the sentinel index of the first free block whose size is in [2^c, 2^(c+1)), -1 if none
+ * bit c of mask is set iff head[c] != -1
+ */
+template <int B>
+struct allocator_placement<segregated_fit, B> {
+    int                head[B];
+    unsigned long long mask;};
+
+/**
+ * rover is the sentinel index of the block the next search starts at
+ */
+template <int B>
+struct allocator_placement<next_fit, B> {
+    int rover;};
+
 // ---------
 // Allocator
 // ---------
 
-template <typename T, std::size_t N>
-class Allocator {
+template <typename T, std::size_t N, typename P = first_fit, check_level C = ALLOCATOR_CHECK_LEVEL,
+          std::size_t A = alignof(T)>
+class Allocator : private allocator_placement<P, allocator_log(N) + 1>,
+                  private allocator_counters<ALLOCATOR_STATS != 0> {
     public:
         // --------
         // typedefs
@@ -56,11 +274,75 @@ class Allocator {
             return !(lhs == rhs);}
 
     private:
+        // --------
+        // typedefs
+        // --------
+
+        typedef allocator_placement<P, allocator_log(N) + 1> placement;
+        typedef allocator_counters<ALLOCATOR_STATS != 0>     counters;
+
+        // ---------
+        // constants
+        // ---------
+
+        static_assert((A & (A - 1)) == 0 && A <= 64, "A must be a power of two no greater than 64");
+        static_assert(A >= alignof(T),               "A must be at least alignof(T)");
+
+        // every block, sentinels included, is a multiple of A long, and the first sentinel sits
+        // sizeof(int) before an A boundary (at 0 when A <= sizeof(int), which divides it), so every
+        // payload starts on an A boundary
+        // the padding is part of the payload the sentinels record
+        // with A = 1, blocks keep the original byte-granular layout
+        static const int grain = A;
+        static const int first = A > sizeof(int) ? A - sizeof(int) : 0;                  // the first sentinel
+        static const int last  = N < A ? first : first + (N - first) / grain * grain;     // one past the last sentinel
+
         // ----
         // data
         // ----
 
-        char a[N];
+        alignas(A) alignas(int) char a[N];
+
+        // --------
+        // min_free
+        // --------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the smallest payload a free block may have
+         * segregated_fit needs room for the next and prev links
+         */
+        template <typename Q>
+        static constexpr std::size_t min_free (Q) {
+            return sizeof(T);}
+
+        static constexpr std::size_t min_free (segregated_fit) {
+            return sizeof(T) > 2 * sizeof(int) ? sizeof(T) : 2 * sizeof(int);}
+
+        // -----
+        // round
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the payload a block needs to hold s bytes and keep the block after it aligned
+         */
+        static int round (int s) {
+            return (s + 2 * sizeof(int) + grain - 1) / grain * grain - 2 * sizeof(int);}
+
+        // ---------
+        // min_block
+        // ---------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the smallest payload any block may have
+         */
+        static int min_block () {
+            return round(min_free(P()));}
 
         // -----
         // valid
@@ -73,8 +355,8 @@ class Allocator {
          * that it is equal to the former sentinel
          */
         bool valid () const {
-            int i = 0;
-            while (i < N){
+            int i = first;
+            while (i < last){
                 int s = (*this)[i];
                 if (s == 0){ // invalid sentinel value
                     throw std::logic_error("Invalid sentinal value");
@@ -91,7 +373,7 @@ class Allocator {
                 //checks unallocated block to make sure that there is enough 
                 //space for two sentinels and at least 1 T
                 else if (s > 0) {  
-                    if (s < sizeof(T)){ // if block is too small, return false, block is invalid
+                    if (s < min_block()){ // if block is too small, return false, block is invalid
                         throw std::logic_error("Block too small");
                         return false;
                     }
@@ -104,8 +386,8 @@ class Allocator {
                         i += s + (2 * sizeof(int)); // increment i to next block
                     }
                 }
-                // i should not be greater than N, once we've accounted for all blocks, i should be equal to N
-                if (i > N){ 
+                // i should not be greater than last, once we've accounted for all blocks, i should be equal to last
+                if (i > last){ 
                     throw std::logic_error("Out of bounds");
                     return false;
                 }
@@ -113,6 +395,70 @@ class Allocator {
             return true;
         }
 
+        // -----------
+        // valid_block
+        // -----------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the checks valid() makes, for the single block whose first sentinel is at i
+         */
+        bool valid_block (int i) const {
+            const int s = (*this)[i];
+            if (s == 0) {
+                throw std::logic_error("Invalid sentinal value");}
+            const int t = s < 0 ? -s : s;
+            if (i + t + 2 * sizeof(int) > last) {
+                throw std::logic_error("Out of bounds");}
+            if (s > 0 && s < min_block()) {
+                throw std::logic_error("Block too small");}
+            if ((*this)[i + t + sizeof(int)] != s) {
+                throw std::logic_error(s < 0 ? "Sentinels don't match" : "Sentinels not matching");}
+            return true;}
+
+        // -----------
+        // valid_local
+        // -----------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * checks the block at i and the blocks directly behind and in front of it
+         */
+        bool valid_local (int i) const {
+            valid_block(i);
+            if (i > first) {
+                const int l = (*this)[i - sizeof(int)];
+                const int j = i - (l < 0 ? -l : l) - 2 * sizeof(int);
+                if (l == 0) {
+                    throw std::logic_error("Invalid sentinal value");}
+                if (j < first) {
+                    throw std::logic_error("Out of bounds");}
+                valid_block(j);}
+            const int s = (*this)[i];
+            const int k = i + (s < 0 ? -s : s) + 2 * sizeof(int);
+            if (k < last) {
+                valid_block(k);}
+            return true;}
+
+        // -----
+        // check
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time with check_local, O(n) with check_full
+         * the check run at the end of an operation that touched the block at i
+         * i is -1 when the block isn't known (construct and destroy), check_local skips those
+         */
+        bool check (int i) const {
+            if (C == check_none || (C == check_local && i == -1)) {
+                return true;}
+            if (C == check_local) {
+                return valid_local(i);}
+            return valid();}
+
         /**
          * O(1) in space
          * O(1) in time
@@ -123,6 +469,365 @@ class Allocator {
         int& operator [] (int i) {
             return *reinterpret_cast<int*>(&a[i]);}
 
+        // ----
+        // find
+        // ----
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * returns the sentinel index of the first free block with at least s bytes, -1 if none
+         * visits every block from sentinel index i on, allocated or not, in address order
+         */
+        int find (int s, int i, first_fit) const {
+            while (i < last) {
+                counters::scan();
+                int t = (*this)[i];
+                if (t >= s) {
+                    return i;}
+                i += (t < 0 ? -t : t) + (2 * sizeof(int));}
+            return -1;}
+
+        /**
+         * O(1) in space
+         * O(1) in time, plus the length of a single size-class list
+         * only the class that s falls in needs a walk, every block in a higher class is big enough
+         */
+        int find (int s, int, segregated_fit) const {
+            const int c = bin(s);
+            int i = placement::head[c];
+            while (i != -1) {
+                counters::scan();
+                if ((*this)[i] >= s) {
+                    return i;}
+                i = (*this)[i + sizeof(int)];}
+            const unsigned long long m = (c + 1 < 64) ? placement::mask >> (c + 1) : 0;
+            if (m == 0) {
+                return -1;}
+            counters::scan();
+            return placement::head[c + 1 + __builtin_ctzll(m)];}
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * first_fit from the rover on, wrapping around to the first block
+         */
+        int find (int s, int, next_fit) const {
+            int i = placement::rover;
+            do {
+                counters::scan();
+                int t = (*this)[i];
+                if (t >= s) {
+                    return i;}
+                i += (t < 0 ? -t : t) + (2 * sizeof(int));
+                if (i == last) {
+                    i = first;}}
+            while (i != placement::rover);
+            return -1;}
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * the smallest free block with at least s bytes, from the first block on
+         * stops at an exact fit, or once L blocks have been visited and one of them fits, then the
+         * smallest so far is taken
+         * past L blocks with nothing that fits, it takes the next block that does, like first_fit
+         */
+        template <int L>
+        int find (int s, int, best_fit<L>) const {
+            int b = -1;
+            int k = 0;
+            int i = first;
+            while (i < last) {
+                counters::scan();
+                int t = (*this)[i];
+                if (t >= s) {
+                    if (b == -1 || t < (*this)[b]) {
+                        b = i;}
+                    if (t == s) {
+                        break;}}
+                if (++k >= L && L != 0 && b != -1) {
+                    break;}
+                i += (t < 0 ? -t : t) + (2 * sizeof(int));}
+            return b;}
+
+        // ---
+        // bin
+        // ---
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the size class of a free block with s bytes, floor of log2(s)
+         */
+        static int bin (int s) {
+            return 63 - __builtin_clzll(s);}
+
+        // ----
+        // link
+        // ----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * pushes the free block at sentinel index i onto the front of its size-class list
+         * i's sentinels must already hold its size
+         */
+        template <typename Q>
+        void link (int, Q) {}
+
+        void link (int i, segregated_fit) {
+            const int c = bin((*this)[i]);
+            const int h = placement::head[c];
+            (*this)[i + sizeof(int)]     = h;
+            (*this)[i + 2 * sizeof(int)] = -1;
+            if (h != -1) {
+                (*this)[h + 2 * sizeof(int)] = i;}
+            placement::head[c] = i;
+            placement::mask |= 1ull << c;}
+
+        // ------
+        // unlink
+        // ------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * removes the free block at sentinel index i from its size-class list
+         * must be called before i's sentinels are overwritten
+         */
+        template <typename Q>
+        void unlink (int, Q) {}
+
+        void unlink (int i, segregated_fit) {
+            const int c = bin((*this)[i]);
+            const int n = (*this)[i + sizeof(int)];
+            const int p = (*this)[i + 2 * sizeof(int)];
+            if (p != -1) {
+                (*this)[p + sizeof(int)] = n;}
+            else {
+                placement::head[c] = n;}
+            if (n != -1) {
+                (*this)[n + 2 * sizeof(int)] = p;}
+            if (placement::head[c] == -1) {
+                placement::mask &= ~(1ull << c);}}
+
+        // -----
+        // clear
+        // -----
+
+        /**
+         * O(1) in space
+         * O(log N) in time
+         * empties every size-class list, puts the rover on the first block
+         */
+        template <typename Q>
+        void clear (Q) {}
+
+        void clear (next_fit) {
+            placement::rover = first;}
+
+        void clear (segregated_fit) {
+            for (int c = 0; c != allocator_log(N) + 1; ++c) {
+                placement::head[c] = -1;}
+            placement::mask = 0;}
+
+        // ------
+        // carved
+        // ------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * next_fit: the next search starts at r, the block after the one just carved
+         */
+        template <typename Q>
+        void carved (int, Q) {}
+
+        void carved (int r, next_fit) {
+            placement::rover = (r == last) ? first : r;}
+
+        // ------
+        // merged
+        // ------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * next_fit: the blocks from lo up to hi just became one, a rover inside it moves to its start
+         */
+        template <typename Q>
+        void merged (int, int, Q) {}
+
+        void merged (int lo, int hi, next_fit) {
+            if (placement::rover > lo && placement::rover < hi) {
+                placement::rover = lo;}}
+
+        // -----
+        // carve
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * marks s bytes of the free block at sentinel index i as allocated
+         * if what is left over can't hold a valid block, the whole block is handed out
+         */
+        void carve (int i, int s) {
+            const int t = (*this)[i];
+            unlink(i, P());
+            if (t - s < (int)(2 * sizeof(int)) + min_block()) {  //coalesces blocks that are too small
+                (*this)[i] = -t;
+                (*this)[i + t + sizeof(int)] = -t;
+                carved(i + t + 2 * sizeof(int), P());}
+            else {  //allocates space and changes sentinels to match the new space remaining
+                const int r = t - s - (2 * sizeof(int));
+                (*this)[i] = -s;
+                (*this)[i + s + sizeof(int)] = -s;
+                (*this)[i + s + 2 * sizeof(int)] = r;
+                (*this)[i + t + sizeof(int)] = r;
+                link(i + s + 2 * sizeof(int), P());
+                carved(i + s + 2 * sizeof(int), P());}}
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the payload of a block for n objects
+         */
+        static int size (size_type n) {
+            int s = n * sizeof(T);
+            if (s < (int)min_free(P())) {  // a freed block has to be able to hold its links
+                s = min_free(P());}
+            return round(s);}
+
+        // ------
+        // header
+        // ------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the sentinel index of the allocated block whose payload starts at p
+         * throw an invalid_argument exception, if p is invalid
+         */
+        int header (pointer p) const {
+            int b = (int)((char*)p - a); //gets index of pointer in allocator
+
+            if (b < first + (int)sizeof(int) || b >= last - (int)sizeof(int)){  //sees that pointer p is within a[N]
+
+                throw std::invalid_argument("Pointer p is out of bounds");
+            }
+
+            const int sentinel_1 = (*this)[b - 4];
+            int e = b + -sentinel_1;
+            //checks that sentinel_2 is within a[N] and sentinel_1 is negative
+            if (e > last - (int)sizeof(int) || e < b || sentinel_1 >= 0) {  
+                throw std::invalid_argument("Pointer p is invalid");
+            }
+            const int sentinel_2 = (*this)[e];
+
+            if (sentinel_1 >= 0 || sentinel_2 >= 0 || sentinel_1 != sentinel_2){ 
+                throw std::invalid_argument("Pointer p is invalid");
+            }
+            return b - sizeof(int);}
+
+        // -------
+        // trusted
+        // -------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the sentinel index of the block at p, if it's in bounds and its header says it was allocated
+         * for n objects, -1 otherwise
+         * one sentinel read, where header() reads both and checks them against each other
+         * a block carve() handed out whole is bigger than size(n) and gets -1
+         */
+        int trusted (const_pointer p, size_type n) const {
+            if (n == 0 || n > N / sizeof(T)) {
+                return -1;}
+            const int h = (int)((const char*)p - a) - sizeof(int);
+            const int s = size(n);
+            if (h < first || h > last - s - (int)(2 * sizeof(int)) || (*this)[h] != -s) {
+                return -1;}
+            return h;}
+
+        // -------
+        // release
+        // -------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * frees the run of adjacent allocated blocks from sentinel index lo up to hi, one past the
+         * run's last sentinel, and coalesces it with the free blocks on either side
+         * the sentinels inside the run must already be cleared
+         * returns the sentinel index of the merged block
+         */
+        int release (int lo, int hi) {
+            int& sentinel_1 = (*this)[lo];
+            int& sentinel_2 = (*this)[hi - sizeof(int)];
+            bool back  = false;
+            bool front = false;
+
+            if (lo > first && (*this)[lo - sizeof(int)] > 0) { //coalesces free block behind
+                int& sentinel_3 = (*this)[lo - sizeof(int)];
+                const int l = lo - sentinel_3 - 2 * sizeof(int);
+                unlink(l, P());
+                sentinel_3 = 0;
+                sentinel_1 = 0;
+                lo = l;
+                back = true;
+            }
+
+            if (hi < last && (*this)[hi] > 0) { //coalesces free block in front
+                int& sentinel_3 = (*this)[hi];
+                const int r = hi + sentinel_3 + 2 * sizeof(int);
+                unlink(hi, P());
+                sentinel_3 = 0;
+                sentinel_2 = 0;
+                hi = r;
+                front = true;
+            }
+
+            const int v = hi - lo - 2 * sizeof(int);
+            (*this)[lo] = v;
+            (*this)[hi - sizeof(int)] = v;
+            link(lo, P());
+            merged(lo, hi, P());
+            counters::coalesced(back, front);
+            return lo;}
+
+        // ---------
+        // release_n
+        // ---------
+
+        /**
+         * O(1) in space
+         * O(k) in time
+         * frees the k allocated blocks whose payloads start at ps[0, k), which must be sorted by address
+         * blocks that touch are merged into one run before coalescing, so each run coalesces once
+         */
+        void release_n (const pointer* ps, size_type k) {
+            size_type j = 0;
+            while (j != k) {
+                const int lo = (char*)ps[j] - a - sizeof(int);
+                int hi = lo - (*this)[lo] + 2 * sizeof(int);
+                while (j + 1 != k && (char*)ps[j + 1] - a == hi + (int)sizeof(int)) {
+                    const int t = -(*this)[hi];
+                    (*this)[hi - sizeof(int)] = 0;
+                    (*this)[hi] = 0;
+                    hi += t + 2 * sizeof(int);
+                    ++j;}
+                const int i = release(lo, hi);
+                assert(C != check_local || valid_local(i));
+                (void)i; // only the assert reads it
+                ++j;}}
+
     public:
         // ------------
         // constructors
@@ -131,16 +836,14 @@ class Allocator {
          * O(1) in space
          * O(1) in time
          * throw a bad_alloc exception, if N is less than sizeof(T) + (2 * sizeof(int))
+         * (segregated_fit also needs room for the two links, A > sizeof(int) for the alignment padding)
          */
         Allocator () {
-            if (N < sizeof(T) + (2 * sizeof(int)))
+            if (last - first < min_block() + (int)(2 * sizeof(int)))
             {
                 throw std::bad_alloc();
             }
-            //sentinels equal amount of space between them
-            (*this)[0] = N - (2 * sizeof(int));
-            (*this)[N - sizeof(int)] = N - (2 * sizeof(int));
-            assert(valid());}
+            reset();}
 
         // Default copy, destructor, and copy assignment
         // Allocator  (const Allocator&);
@@ -153,60 +856,49 @@ class Allocator {
 
         /**
          * O(1) in space
-         * O(n) in time
+         * O(n) in time with first_fit, next_fit and best_fit, O(1) per size class with segregated_fit
          * after allocation there must be enough space left for a valid block
          * the smallest allowable block is sizeof(T) + (2 * sizeof(int))
-         * choose the first block that fits
+         * choose the block the placement policy P picks
          * throw a bad_alloc exception, if n is invalid
          */
         pointer allocate (size_type n) {
-            // can't allocate negative sized blocks, throw bad_alloc
-            if (n < 0) {
-                throw std::bad_alloc();
-            }
             if (n == 0) { //doesn't allocate space and returns null
                 return nullptr;
             }
-            int i = 0;
-            bool not_done = true;
-            while (i < N && not_done) {
-                int s = (*this)[i];
-                if (s < 0) {  //skips past allocated block
-                    i += -s + (2 * sizeof(int));
-                }
-                else if (s < (n * sizeof(T))) {  //skips past blocks that are too small
-                    i += s + (2 * sizeof(int));
-                }
-                else {  //acually allocates space
-                    if (s - ( n * sizeof(T) ) < (2 * sizeof(int) + sizeof(T)))  //coalesces blocks that are too small
-                    {
-                        (*this)[i] = -s;
-                        (*this)[i + s + sizeof(int)] = -s;
-                    }
-                    else if (s - n == 0)  //simply adapts all the space at the sentinel
-                    {
-                        (*this)[i] = -s;
-                        (*this)[i + s + sizeof(int)] = -s;
-                    }
-                    else {  //allocates space and changes sentinels to match the new space remaining
-                        (*this)[i] = -n * sizeof(T);
-                        (*this)[i + n * sizeof(T) + sizeof(int)] = -n * sizeof(T);
-                        (*this)[i + n * sizeof(T) + 2 * sizeof(int)] = s - n * sizeof(T) - (2 * sizeof(int));
-                        (*this)[i + s + sizeof(int)] = s - n * sizeof(T) - (2 * sizeof(int));
-                    }
-                    
-                    not_done = false;
-                }
-            }
-            if (i == N)  //this means there wasn't enough room for allocation
+            const pointer p = try_allocate(n);
+            if (p == nullptr)  //this means there wasn't enough room for allocation
             {
+                counters::failed();
                 throw std::bad_alloc();
             }
-
-            assert(valid());
-            return  reinterpret_cast<T*>(&a[i + sizeof(int)]);
+            return p;
         }         
 
+        // ------------
+        // try_allocate
+        // ------------
+
+        /**
+         * O(1) in space
+         * the time of allocate
+         * allocate, but returns nullptr instead of throwing when n is too big or nothing fits
+         * returns nullptr if n is 0
+         * a miss isn't counted in failures, nothing was thrown
+         */
+        pointer try_allocate (size_type n) {
+            if (n == 0 || n > N / sizeof(T)) {
+                return nullptr;}
+            const int s = size(n);
+            const int i = find(s, first, P());
+            counters::searched();
+            if (i == -1) {
+                return nullptr;}
+            carve(i, s);
+            counters::allocated(n * sizeof(T), 1);
+            assert(check(i));
+            return reinterpret_cast<pointer>(&a[i + sizeof(int)]);}
+
         // ---------
         // construct
         // ---------
@@ -217,7 +909,7 @@ class Allocator {
          */
         void construct (pointer p, const_reference v) {
             new (p) T(v);                               // this is correct and exempt
-            assert(valid());}                           // from the prohibition of new
+            assert(check(-1));}                         // from the prohibition of new
 
         // ----------
         // deallocate
@@ -227,73 +919,568 @@ class Allocator {
          * O(1) in space
          * O(1) in time
          * after deallocation adjacent free blocks must be coalesced
+         * with segregated_fit the merged neighbours leave their lists and the result joins its own
          * throw an invalid_argument exception, if p is invalid
          * Upon receiving the pointer, the function checks the sentinels to see that they're valid.
          * Then it deallocates the block and coalesces free space on either side
          */
         void deallocate (pointer p, size_type n) {
-            int b = (int)((char*)p - a); //gets index of pointer in allocator
+            const int h = header(p);
+            const int i = release(h, h - (*this)[h] + 2 * sizeof(int));
+            counters::deallocated(1);
+            assert(check(i));
+            (void)i;}
 
-            if (b < sizeof(int) || b >= N - sizeof(int)){  //sees that pointer p is within a[N]
+        // ------------------
+        // deallocate_trusted
+        // ------------------
 
-                throw std::invalid_argument("Pointer p is out of bounds");
-            }
+        /**
+         * O(1) in space
+         * O(1) in time
+         * deallocate for a caller that guarantees p came from allocate(n) on this allocator and hasn't
+         * been freed since
+         * a block whose header matches size(n) is freed without the rest of header()'s checks, anything
+         * else goes through deallocate
+         * a pointer that breaks the guarantee can free part of a live block undetected
+         * throw an invalid_argument exception, if p falls through to deallocate and is invalid
+         */
+        void deallocate_trusted (pointer p, size_type n) {
+            const int h = trusted(p, n);
+            if (h == -1) {
+                deallocate(p, n);
+                return;}
+            const int i = release(h, h + size(n) + 2 * sizeof(int));
+            counters::deallocated(1);
+            assert(check(i));
+            (void)i;}
 
-            int& sentinel_1 = (*this)[b - 4];
-            int e = b + -sentinel_1;
-            //checks that sentinel_2 is within a[N] and sentinel_1 is negative
-            if (e > N || e < b || sentinel_1 >= 0) {  
-                throw std::invalid_argument("Pointer p is invalid");
-            }
-            int& sentinel_2 = (*this)[e];
+        // --------------
+        // allocate_batch
+        // --------------
 
-            if (sentinel_1 >= 0 || sentinel_2 >= 0 || sentinel_1 != sentinel_2){ 
-                throw std::invalid_argument("Pointer p is invalid");
-            }
+        /**
+         * O(1) in space
+         * O(n) in time with first_fit and next_fit, a single forward pass, since nothing behind a
+         * block it just carved can fit the next one
+         * O(k n) in time with best_fit, O(k) with segregated_fit
+         * fills out[0, k) with blocks of n objects each and checks the heap once at the end
+         * (check_local still looks at each block it carves)
+         * throw a bad_alloc exception, if they don't all fit, nothing stays allocated then
+         */
+        void allocate_batch (size_type n, size_type k, pointer* out) {
+            if (n > N / sizeof(T)) {
+                counters::failed();
+                throw std::bad_alloc();}
+            if (n == 0) {
+                std::fill(out, out + k, nullptr);
+                return;}
+            const int s = size(n);
+            int i = first;
+            for (size_type j = 0; j != k; ++j) {
+                i = find(s, i, P());
+                counters::searched();
+                if (i == -1) {
+                    std::sort(out, out + j, std::less<pointer>());
+                    release_n(out, j);
+                    counters::failed();
+                    throw std::bad_alloc();}
+                carve(i, s);
+                assert(C != check_local || valid_local(i));
+                out[j] = reinterpret_cast<pointer>(&a[i + sizeof(int)]);}
+            counters::allocated(n * sizeof(T), k);
+            assert(C != check_full || valid());}
 
-            if (b > sizeof(int)  && (*this)[b - 2 * sizeof(int)] > 0 && e < (N - sizeof(int)) && (*this)[e + sizeof(int)] > 0) { //coalesces free blocks on both sides
-                int oe = b - 2 * sizeof(int);
-                int ob = e + sizeof(int);
-                int& sentinel_l = (*this)[oe];
-                int& sentinel_r = (*this)[ob];
-                int v = sentinel_l + sentinel_r + -sentinel_1 + 4 * sizeof(int);
-                (*this)[oe - sentinel_l - sizeof(int)] = v;
-                (*this)[ob + sentinel_r + sizeof(int)] = v;
-                sentinel_l = 0;
-                sentinel_r = 0;
-                sentinel_1 = 0;
-                sentinel_2 = 0;
-            }
+        // ----------------
+        // deallocate_batch
+        // ----------------
 
-            else if (b > sizeof(int)  && (*this)[b - 2 * sizeof(int)] > 0) { //coalesces free block behind
-                int oe = b - 2 * sizeof(int);
-                int& sentinel_3 = (*this)[oe];
-                int& sentinel_4 = (*this)[oe - sentinel_3 - sizeof(int)];
-                int v = -sentinel_1 + sentinel_3 + 2 * sizeof(int);
-                sentinel_4 = v;
-                sentinel_2 = v;
-                sentinel_3 = 0;
-                sentinel_1 = 0;
-            }
+        /**
+         * O(1) in space
+         * O(k log k) in time, for the sort
+         * frees the k blocks of n objects at ps[0, k), sorting ps by address in place
+         * every pointer is checked before anything is freed, so a bad one leaves the heap as it was
+         * blocks that touch coalesce as one run and the heap is checked once at the end
+         * (check_local still looks at each run)
+         * throw an invalid_argument exception, if a pointer is invalid or appears twice
+         */
+        void deallocate_batch (pointer* ps, size_type k, size_type n) {
+            std::sort(ps, ps + k, std::less<pointer>());
+            for (size_type j = 0; j != k; ++j) {
+                header(ps[j]);
+                if (j != 0 && ps[j] == ps[j - 1]) {
+                    throw std::invalid_argument("Pointer p is invalid");}}
+            release_n(ps, k);
+            counters::deallocated(k);
+            assert(C != check_full || valid());}
 
-            else if (e < (N - sizeof(int)) && (*this)[e + sizeof(int)] > 0) //coalesces free block in front
-            {
-                int ob = e + sizeof(int);
-                int& sentinel_3 = (*this)[ob];
-                int& sentinel_4 = (*this)[ob + sizeof(int) + sentinel_3];
-                int v = -sentinel_1 + sentinel_3 + 2 * sizeof(int);
-                sentinel_1 = v;
-                sentinel_4 = v;
-                sentinel_3 = 0;
-                sentinel_2 = 0;
-            }
+        // -------
+        // destroy
+        // -------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        void destroy (pointer p) {
+            p->~T();               // this is correct
+            assert(check(-1));}
+
+        // ----------
+        // check_heap
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * runs valid() on demand, whatever the check level and even with asserts disabled
+         * throws a logic_error describing the first bad block it finds
+         */
+        bool check_heap () const {
+            return valid();}
+
+        // -----
+        // reset
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time, O(log N) with segregated_fit to empty its lists
+         * frees every block at once by rewriting the sentinel pair that spans the arena
+         * the sentinels of the blocks that were handed out are left behind and never read again
+         * the objects in them aren't destroyed
+         */
+        void reset () {
+            //sentinels equal amount of space between them
+            (*this)[first] = last - first - (2 * sizeof(int));
+            (*this)[last - sizeof(int)] = last - first - (2 * sizeof(int));
+            clear(P());
+            link(first, P());
+            assert(check(first));}
+
+        // -----
+        // empty
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * true iff nothing is allocated, the arena is back to the one free block the constructor made
+         */
+        bool empty () const {
+            return (*this)[first] == last - first - (int)(2 * sizeof(int));}
+
+        // -----
+        // stats
+        // -----
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * the counters, plus the byte totals and fragmentation from walking the sentinels the way valid() does
+         * throw a logic_error exception, if it meets a zero sentinel
+         */
+        allocator_stats stats () const {
+            allocator_stats r;
+            counters::counts(r);
+            r.blocks         = 0;
+            r.free_blocks    = 0;
+            r.bytes_live     = 0;
+            r.bytes_free     = 0;
+            r.bytes_sentinel = 0;
+            r.largest_free   = 0;
+            int i = first;
+            while (i < last) {
+                const int s = (*this)[i];
+                if (s == 0) {
+                    throw std::logic_error("Invalid sentinal value");}
+                ++r.blocks;
+                r.bytes_sentinel += 2 * sizeof(int);
+                if (s < 0) {
+                    r.bytes_live += -s;}
+                else {
+                    ++r.free_blocks;
+                    r.bytes_free += s;
+                    if ((std::size_t)s > r.largest_free) {
+                        r.largest_free = s;}}
+                i += (s < 0 ? -s : s) + 2 * sizeof(int);}
+            r.fragmentation = r.bytes_free == 0 ? 0 : 1 - (double)r.largest_free / r.bytes_free;
+            return r;}
+
+        // ----
+        // dump
+        // ----
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * writes the heap map to out, one line per block: the index of its first sentinel, the sentinel
+         * and whether it's allocated or free
+         * stops at the first block valid() would reject and says why, so a corrupt heap can be dumped too
+         */
+        void dump (std::ostream& out) const {
+            int i = first;
+            while (i < last) {
+                const int s = (*this)[i];
+                const int t = s < 0 ? -s : s;
+                out << std::setw(8) << i << " " << std::setw(8) << s << " ";
+                if (s == 0) {
+                    out << "invalid sentinel\n";
+                    return;}
+                if (s > 0 && s < min_block()) {
+                    out << "block too small\n";
+                    return;}
+                if (i + t + 2 * sizeof(int) > last) {
+                    out << "out of bounds\n";
+                    return;}
+                if ((*this)[i + t + sizeof(int)] != s) {
+                    out << "sentinels don't match\n";
+                    return;}
+                out << (s < 0 ? "allocated" : "free") << "\n";
+                i += t + 2 * sizeof(int);}}
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * It takes the four bytes on top of the reference, turns it into an
+         * int, and returns a contant alias to the value at the address
+         */
+        const int& operator [] (int i) const {
+            return *reinterpret_cast<const int*>(&a[i]);}};
+
+// ----------------------------------
+// Allocator<T, N, fixed_pool, C, A>
+// ----------------------------------
+
+/**
+ * a pool of N / slot equal A-aligned slots, no sentinels
+ * a free slot holds the index of the next free slot in its first int
+ * slots past fresh have never been handed out and aren't on the stack yet
+ * only single objects can be allocated
+ */
+template <typename T, std::size_t N, check_level C, std::size_t A>
+class Allocator<T, N, fixed_pool, C, A> {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T                 value_type;
+
+        typedef std::size_t       size_type;
+        typedef std::ptrdiff_t    difference_type;
+
+        typedef       value_type*       pointer;
+        typedef const value_type* const_pointer;
+
+        typedef       value_type&       reference;
+        typedef const value_type& const_reference;
+
+    public:
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const Allocator&, const Allocator&) {
+            return true;}
+
+        // -----------
+        // operator !=
+        // -----------
+
+        friend bool operator != (const Allocator& lhs, const Allocator& rhs) {
+            return !(lhs == rhs);}
+
+    private:
+        // ---------
+        // constants
+        // ---------
+
+        static_assert((A & (A - 1)) == 0 && A <= 64, "A must be a power of two no greater than 64");
+        static_assert(A >= alignof(T),               "A must be at least alignof(T)");
+
+        // big enough for a T or the link, rounded up to a multiple of A so every slot is A-aligned
+        static const std::size_t slot  = ((sizeof(T) > sizeof(int) ? sizeof(T) : sizeof(int)) + A - 1) / A * A;
+        static const std::size_t slots = N / slot;
+
+        // ----
+        // data
+        // ----
+
+        alignas(A) alignas(int) char a[N];
+        unsigned char used[slots / 8 + 1];   // bit k is set iff slot k is allocated
+        int head;                             // first slot on the free stack, -1 if none
+        int fresh;                            // first slot never handed out
+        int live;                             // slots allocated now
+
+        // ---------
+        // allocated
+        // ---------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        bool allocated (int k) const {
+            return (used[k / 8] >> (k % 8)) & 1;}
+
+        // ----
+        // next
+        // ----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the free-stack link stored in slot k
+         */
+        int& next (int k) {
+            return *reinterpret_cast<int*>(&a[k * slot]);}
+
+        int next (int k) const {
+            return *reinterpret_cast<const int*>(&a[k * slot]);}
 
+        // -----
+        // valid
+        // -----
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * walks the free stack, every slot on it must be below fresh, not allocated and seen once
+         * the slots on the stack plus the allocated ones must account for every slot below fresh
+         */
+        bool valid () const {
+            if (fresh < 0 || fresh > (int)slots) {
+                throw std::logic_error("Out of bounds");}
+            int f = 0;
+            int k = head;
+            while (k != -1) {
+                if (k < 0 || k >= fresh || allocated(k) || f == fresh) {
+                    throw std::logic_error("Invalid free slot");}
+                ++f;
+                k = next(k);}
+            int u = 0;
+            for (int j = 0; j != fresh; ++j) {
+                u += allocated(j);}
+            if (f + u != fresh || u != live) {
+                throw std::logic_error("Slots not matching");}
+            return true;}
+
+        // -----------
+        // valid_local
+        // -----------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * slot k must have been handed out and be in the state the operation left it in
+         * the head of the free stack must be a slot that was handed out
+         */
+        bool valid_local (int k, bool u) const {
+            if (k < 0 || k >= fresh || head < -1 || head >= fresh) {
+                throw std::logic_error("Out of bounds");}
+            if (allocated(k) != u || (head != -1 && allocated(head))) {
+                throw std::logic_error("Invalid free slot");}
+            return true;}
+
+        // -----
+        // check
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time with check_local, O(n) with check_full
+         * the check run at the end of an operation that touched slot k, which should now be allocated iff u
+         * k is -1 when no slot was touched
+         */
+        bool check (int k, bool u) const {
+            if (C == check_none || (C == check_local && k == -1)) {
+                return true;}
+            if (C == check_local) {
+                return valid_local(k, u);}
+            return valid();}
+
+        // -------
+        // slot_of
+        // -------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the slot p points into
+         */
+        int slot_of (const_pointer p) const {
+            return (reinterpret_cast<const char*>(p) - a) / (std::ptrdiff_t)slot;}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * O(1) in space
+         * O(n / slot) in time, to clear the allocated bits
+         * throw a bad_alloc exception, if N can't hold a single slot
+         */
+        Allocator () :
+                head  (-1),
+                fresh (0),
+                live  (0) {
+            if (slots == 0) {
+                throw std::bad_alloc();}
+            std::fill(used, used + sizeof(used), 0);
+            assert(check(-1, false));}
+
+        // Default copy, destructor, and copy assignment
+        // Allocator  (const Allocator&);
+        // ~Allocator ();
+        // Allocator& operator = (const Allocator&);
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * pops the free stack, or takes the next fresh slot
+         * returns nullptr if n is 0
+         * throw a bad_alloc exception, if n is greater than 1 or the pool is full
+         */
+        pointer allocate (size_type n) {
+            if (n == 0) {
+                return nullptr;}
+            const pointer p = try_allocate(n);
+            if (p == nullptr) {
+                throw std::bad_alloc();}
+            return p;}
+
+        // ------------
+        // try_allocate
+        // ------------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * allocate, but returns nullptr instead of throwing when n is greater than 1 or the pool is full
+         * returns nullptr if n is 0
+         */
+        pointer try_allocate (size_type n) {
+            if (n != 1) {
+                return nullptr;}
+            int k = head;
+            if (k != -1) {
+                head = next(k);}
+            else if (fresh != (int)slots) {
+                k = fresh++;}
             else {
-                sentinel_1 = -sentinel_1;
-                sentinel_2 = -sentinel_2;
-            } 
+                return nullptr;}
+            used[k / 8] |= 1 << (k % 8);
+            ++live;
+            assert(check(k, true));
+            return reinterpret_cast<pointer>(&a[k * slot]);}
 
-            assert(valid());}
+        // ---------
+        // construct
+        // ---------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        void construct (pointer p, const_reference v) {
+            new (p) T(v);
+            assert(check(slot_of(p), true));}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * pushes the slot back on the free stack
+         * throw an invalid_argument exception, if p is outside the pool, isn't the start of a slot
+         * or isn't allocated
+         */
+        void deallocate (pointer p, size_type) {
+            const std::ptrdiff_t b = reinterpret_cast<char*>(p) - a;
+            if (b < 0 || b >= (std::ptrdiff_t)(slots * slot)) {
+                throw std::invalid_argument("Pointer p is out of bounds");}
+            const int k = b / slot;
+            if (b % slot != 0 || !allocated(k)) {
+                throw std::invalid_argument("Pointer p is invalid");}
+            used[k / 8] &= ~(1 << (k % 8));
+            next(k) = head;
+            head = k;
+            --live;
+            assert(check(k, false));}
+
+        // --------------
+        // allocate_batch
+        // --------------
+
+        /**
+         * O(1) in space
+         * O(k) in time
+         * fills out[0, k) with single objects and checks the pool once at the end
+         * throw a bad_alloc exception, if n is greater than 1 or they don't all fit,
+         * nothing stays allocated then
+         */
+        void allocate_batch (size_type n, size_type k, pointer* out) {
+            if (n == 0) {
+                std::fill(out, out + k, nullptr);
+                return;}
+            if (n != 1) {
+                throw std::bad_alloc();}
+            for (size_type j = 0; j != k; ++j) {
+                int i = head;
+                if (i != -1) {
+                    head = next(i);}
+                else if (fresh != (int)slots) {
+                    i = fresh++;}
+                else {
+                    while (j != 0) {
+                        const int r = slot_of(out[--j]);
+                        used[r / 8] &= ~(1 << (r % 8));
+                        next(r) = head;
+                        head = r;
+                        --live;}
+                    throw std::bad_alloc();}
+                used[i / 8] |= 1 << (i % 8);
+                assert(C != check_local || valid_local(i, true));
+                out[j] = reinterpret_cast<pointer>(&a[i * slot]);
+                ++live;}
+            assert(C != check_full || valid());}
+
+        // ----------------
+        // deallocate_batch
+        // ----------------
+
+        /**
+         * O(1) in space
+         * O(k log k) in time, for the sort
+         * frees the k single objects at ps[0, k), sorting ps by address in place
+         * they're pushed highest first, so the next allocations come back in address order
+         * every pointer is checked before anything is freed and the pool is checked once at the end
+         * throw an invalid_argument exception, if a pointer is invalid or appears twice
+         */
+        void deallocate_batch (pointer* ps, size_type k, size_type) {
+            std::sort(ps, ps + k, std::less<pointer>());
+            for (size_type j = 0; j != k; ++j) {
+                const std::ptrdiff_t b = reinterpret_cast<char*>(ps[j]) - a;
+                if (b < 0 || b >= (std::ptrdiff_t)(slots * slot)) {
+                    throw std::invalid_argument("Pointer p is out of bounds");}
+                if (b % slot != 0 || !allocated(b / slot) || (j != 0 && ps[j] == ps[j - 1])) {
+                    throw std::invalid_argument("Pointer p is invalid");}}
+            for (size_type j = k; j != 0; --j) {
+                const int i = slot_of(ps[j - 1]);
+                used[i / 8] &= ~(1 << (i % 8));
+                next(i) = head;
+                head = i;
+                --live;
+                assert(C != check_local || valid_local(i, false));}
+            assert(C != check_full || valid());}
 
         // -------
         // destroy
@@ -304,14 +1491,327 @@ class Allocator {
          * O(1) in time
          */
         void destroy (pointer p) {
-            p->~T();               // this is correct
-            assert(valid());}
+            p->~T();
+            assert(check(slot_of(p), true));}
+
+        // -----
+        // empty
+        // -----
 
         /**
          * O(1) in space
          * O(1) in time
-         * It takes the four bytes on top of the reference, turns it into an
-         * int, and returns a contant alias to the value at the address
+         * whether no slot is allocated
+         */
+        bool empty () const {
+            return live == 0;}
+
+        // ----------
+        // check_heap
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * runs valid() on demand, whatever the check level and even with asserts disabled
+         */
+        bool check_heap () const {
+            return valid();}};
+
+// ---------------------------------
+// Allocator<T, N, monotonic, C, A>
+// ---------------------------------
+
+/**
+ * a bump allocator on the same arena, whose only sentinels are the pair the constructor writes
+ * blocks are handed out from top up, each rounded to a multiple of A, with no sentinels of their own
+ * nothing is freed until reset()
+ */
+template <typename T, std::size_t N, check_level C, std::size_t A>
+class Allocator<T, N, monotonic, C, A> {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T                 value_type;
+
+        typedef std::size_t       size_type;
+        typedef std::ptrdiff_t    difference_type;
+
+        typedef       value_type*       pointer;
+        typedef const value_type* const_pointer;
+
+        typedef       value_type&       reference;
+        typedef const value_type& const_reference;
+
+    public:
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const Allocator&, const Allocator&) {
+            return true;}
+
+        // -----------
+        // operator !=
+        // -----------
+
+        friend bool operator != (const Allocator& lhs, const Allocator& rhs) {
+            return !(lhs == rhs);}
+
+    private:
+        // ---------
+        // constants
+        // ---------
+
+        static_assert((A & (A - 1)) == 0 && A <= 64, "A must be a power of two no greater than 64");
+        static_assert(A >= alignof(T),               "A must be at least alignof(T)");
+
+        // the same layout as the boundary-tag arena, the payload of its one block starts on an A boundary
+        static const int grain = A;
+        static const int first = A > sizeof(int) ? A - sizeof(int) : 0;                  // the first sentinel
+        static const int last  = N < A ? first : first + (N - first) / grain * grain;     // one past the last sentinel
+
+        // ----
+        // data
+        // ----
+
+        alignas(A) alignas(int) char a[N];
+        int top;                              // the index the next block starts at
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the bytes a block for n objects takes, keeping the next one A-aligned
+         */
+        static int size (size_type n) {
+            return (n * sizeof(T) + A - 1) / A * A;}
+
+        // -----
+        // valid
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the sentinel pair must still span the arena and top must be inside it
+         */
+        bool valid () const {
+            const int s = last - first - 2 * sizeof(int);
+            if ((*this)[first] != s || (*this)[last - sizeof(int)] != s) {
+                throw std::logic_error("Sentinels don't match");}
+            if (top < first + (int)sizeof(int) || top > last - (int)sizeof(int)) {
+                throw std::logic_error("Out of bounds");}
+            return true;}
+
+        // -----
+        // check
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * valid() costs O(1), so check_local and check_full both run it
+         */
+        bool check () const {
+            return C == check_none || valid();}
+
+        // ------
+        // inside
+        // ------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * throw an invalid_argument exception, if p isn't in a block handed out since the last reset()
+         */
+        void inside (const_pointer p) const {
+            const std::ptrdiff_t b = reinterpret_cast<const char*>(p) - a;
+            if (b < first + (std::ptrdiff_t)sizeof(int) || b >= top) {
+                throw std::invalid_argument("Pointer p is out of bounds");}}
+
+        int& operator [] (int i) {
+            return *reinterpret_cast<int*>(&a[i]);}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * throw a bad_alloc exception, if N is less than sizeof(T) + (2 * sizeof(int))
+         */
+        Allocator () {
+            if (last - first < (int)(sizeof(T) + 2 * sizeof(int))) {
+                throw std::bad_alloc();}
+            reset();}
+
+        // Default copy, destructor, and copy assignment
+        // Allocator  (const Allocator&);
+        // ~Allocator ();
+        // Allocator& operator = (const Allocator&);
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * moves top past a block for n objects
+         * throw a bad_alloc exception, if what's left of the arena can't hold it
+         */
+        pointer allocate (size_type n) {
+            if (n == 0) {
+                return nullptr;}
+            const pointer p = try_allocate(n);
+            if (p == nullptr) {
+                throw std::bad_alloc();}
+            return p;}
+
+        // ------------
+        // try_allocate
+        // ------------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * allocate, but returns nullptr instead of throwing when what's left of the arena can't hold it
+         * returns nullptr if n is 0
+         */
+        pointer try_allocate (size_type n) {
+            if (n == 0 || n > N / sizeof(T) || size(n) > last - (int)sizeof(int) - top) {
+                return nullptr;}
+            const pointer p = reinterpret_cast<pointer>(&a[top]);
+            top += size(n);
+            assert(check());
+            return p;}
+
+        // ---------
+        // construct
+        // ---------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        void construct (pointer p, const_reference v) {
+            new (p) T(v);
+            assert(check());}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * does nothing, the block comes back at the next reset()
+         * throw an invalid_argument exception, if p isn't in a block handed out since the last reset()
+         */
+        void deallocate (pointer p, size_type) {
+            inside(p);
+            assert(check());}
+
+        // --------------
+        // allocate_batch
+        // --------------
+
+        /**
+         * O(1) in space
+         * O(k) in time
+         * fills out[0, k) with consecutive blocks of n objects each
+         * throw a bad_alloc exception, if they don't all fit, nothing is allocated then
+         */
+        void allocate_batch (size_type n, size_type k, pointer* out) {
+            if (n == 0) {
+                std::fill(out, out + k, nullptr);
+                return;}
+            if (n > N / sizeof(T) || (std::size_t)size(n) * k > (std::size_t)(last - (int)sizeof(int) - top)) {
+                throw std::bad_alloc();}
+            for (size_type j = 0; j != k; ++j) {
+                out[j] = reinterpret_cast<pointer>(&a[top]);
+                top += size(n);}
+            assert(check());}
+
+        // ----------------
+        // deallocate_batch
+        // ----------------
+
+        /**
+         * O(1) in space
+         * O(k) in time
+         * does nothing but check the k pointers at ps[0, k)
+         * throw an invalid_argument exception, if a pointer isn't in a block handed out since the last reset()
+         */
+        void deallocate_batch (pointer* ps, size_type k, size_type) {
+            for (size_type j = 0; j != k; ++j) {
+                inside(ps[j]);}
+            assert(check());}
+
+        // -------
+        // destroy
+        // -------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        void destroy (pointer p) {
+            p->~T();
+            assert(check());}
+
+        // -----
+        // reset
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * frees every block at once: rewrites the sentinel pair and puts top back at the start
+         * the objects in them aren't destroyed
+         */
+        void reset () {
+            (*this)[first]              = last - first - (2 * sizeof(int));
+            (*this)[last - sizeof(int)] = last - first - (2 * sizeof(int));
+            top = first + sizeof(int);
+            assert(check());}
+
+        // ----------
+        // check_heap
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * runs valid() on demand, whatever the check level and even with asserts disabled
+         */
+        bool check_heap () const {
+            return valid();}
+
+        // -----
+        // empty
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * true iff nothing has been allocated since the last reset()
+         */
+        bool empty () const {
+            return top == first + (int)sizeof(int);}
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the int at index i in a
          */
         const int& operator [] (int i) const {
             return *reinterpret_cast<const int*>(&a[i]);}};
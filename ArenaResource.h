@@ -0,0 +1,276 @@
+// ----------------------------------
+// projects/allocator/ArenaResource.h
+// Copyright (C) 2015
+// Glenn P. Downing
+// ----------------------------------
+
+#ifndef ArenaResource_h
+#define ArenaResource_h
+
+// --------
+// includes
+// --------
+
+#include <cstddef>          // max_align_t, ptrdiff_t, size_t
+#include <cstdint>          // uintptr_t
+#include <memory_resource>  // memory_resource
+#include <new>              // bad_alloc
+#include <type_traits>      // true_type
+
+#include "Allocator.h"
+
+// -------------
+// ArenaResource
+// -------------
+
+/**
+ * one boundary-tag arena of N bytes as a std::pmr::memory_resource
+ * any size and any power-of-two alignment, blocks come out A-aligned and bigger alignments are padded
+ * into the block
+ * nothing goes upstream, a request that doesn't fit throws bad_alloc
+ * equal only to itself, and it can't be copied or moved, the blocks it handed out live in it
+ */
+template <std::size_t N, typename P = segregated_fit, check_level C = ALLOCATOR_CHECK_LEVEL,
+          std::size_t A = alignof(std::max_align_t)>
+class ArenaResource final : public std::pmr::memory_resource {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef Allocator<char, N, P, C, A> arena_type;
+
+    private:
+        // ---------
+        // constants
+        // ---------
+
+        // an over-aligned block keeps its padding in the int just before the pointer handed out,
+        // the padding is a multiple of A, so there's always room
+        static_assert(A > sizeof(int), "A must be greater than sizeof(int)");
+
+        // ----
+        // data
+        // ----
+
+        arena_type arena;
+
+        // -----------
+        // do_allocate
+        // -----------
+
+        /**
+         * O(1) in space
+         * O(1) in time with segregated_fit, O(n) with the other policies
+         * the arena's allocate, plus alignment bytes of padding if alignment is greater than A
+         * throw a bad_alloc exception, if the arena can't satisfy the request
+         */
+        void* do_allocate (std::size_t bytes, std::size_t alignment) override {
+            if (bytes == 0) {
+                bytes = 1;}
+            if (alignment <= A) {
+                return arena.allocate(bytes);}
+            if (alignment >= N || bytes > N - alignment) {
+                throw std::bad_alloc();}
+            char* p = arena.allocate(bytes + alignment);
+            char* q = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(p) + alignment) & ~(alignment - 1));
+            *reinterpret_cast<int*>(q - sizeof(int)) = q - p;
+            return q;}
+
+        // -------------
+        // do_deallocate
+        // -------------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the arena's deallocate, on the start of the block if p was padded
+         * throw an invalid_argument exception, if p is invalid
+         */
+        void do_deallocate (void* p, std::size_t bytes, std::size_t alignment) override {
+            if (bytes == 0) {
+                bytes = 1;}
+            char* q = static_cast<char*>(p);
+            if (alignment <= A) {
+                arena.deallocate(q, bytes);
+                return;}
+            arena.deallocate(q - *reinterpret_cast<const int*>(q - sizeof(int)), bytes + alignment);}
+
+        // -----------
+        // do_is_equal
+        // -----------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        bool do_is_equal (const std::pmr::memory_resource& that) const noexcept override {
+            return this == &that;}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        ArenaResource () = default;
+
+        ArenaResource             (const ArenaResource&) = delete;
+        ArenaResource& operator = (const ArenaResource&) = delete;
+
+        // ----------
+        // check_heap
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         */
+        bool check_heap () const {
+            return arena.check_heap();}
+
+        // -----
+        // empty
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        bool empty () const {
+            return arena.empty();}
+
+        // -----
+        // stats
+        // -----
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * sizes are in bytes, padding for over-aligned blocks included
+         */
+        allocator_stats stats () const {
+            return arena.stats();}};
+
+// --------------
+// ArenaAllocator
+// --------------
+
+/**
+ * a typed handle on a resource R, such as an ArenaResource
+ * it rebinds, so containers of any element type can share one R, and handles compare equal iff
+ * they share it
+ * copying, moving or swapping a container takes its handle along
+ * R is held by pointer and has to outlive every handle on it
+ */
+template <typename T, typename R>
+class ArenaAllocator {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T                 value_type;
+
+        typedef std::size_t       size_type;
+        typedef std::ptrdiff_t    difference_type;
+
+        typedef       value_type*       pointer;
+        typedef const value_type* const_pointer;
+
+        typedef       value_type&       reference;
+        typedef const value_type& const_reference;
+
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        template <typename U>
+        struct rebind {
+            typedef ArenaAllocator<U, R> other;};
+
+    public:
+        // -----------
+        // operator ==
+        // -----------
+
+        template <typename U>
+        friend bool operator == (const ArenaAllocator& lhs, const ArenaAllocator<U, R>& rhs) {
+            return lhs.resource() == rhs.resource();}
+
+        // -----------
+        // operator !=
+        // -----------
+
+        template <typename U>
+        friend bool operator != (const ArenaAllocator& lhs, const ArenaAllocator<U, R>& rhs) {
+            return !(lhs == rhs);}
+
+    private:
+        // ----
+        // data
+        // ----
+
+        R* r;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        explicit ArenaAllocator (R& r) :
+                r (&r)
+            {}
+
+        template <typename U>
+        ArenaAllocator (const ArenaAllocator<U, R>& that) :
+                r (that.resource())
+            {}
+
+        // Default copy, destructor, and copy assignment
+        // ArenaAllocator  (const ArenaAllocator&);
+        // ~ArenaAllocator ();
+        // ArenaAllocator& operator = (const ArenaAllocator&);
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * O(1) in space
+         * the time of R's allocate
+         * R's allocate for n Ts, aligned for T
+         * throw a bad_alloc exception, if R can't satisfy the request
+         */
+        pointer allocate (size_type n) {
+            if (n > (size_type)-1 / sizeof(T)) {
+                throw std::bad_alloc();}
+            return static_cast<pointer>(r->allocate(n * sizeof(T), alignof(T)));}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * O(1) in space
+         * the time of R's deallocate
+         * R's deallocate for n Ts
+         */
+        void deallocate (pointer p, size_type n) {
+            r->deallocate(p, n * sizeof(T), alignof(T));}
+
+        // --------
+        // resource
+        // --------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        R* resource () const {
+            return r;}};
+
+#endif // ArenaResource_h
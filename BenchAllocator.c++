@@ -0,0 +1,857 @@
+// ------------------------------------
+// projects/allocator/BenchAllocator.c++
+// Copyright (C) 2015
+// Glenn P. Downing
+// ------------------------------------
+
+// --------
+// includes
+// --------
+
+#include <algorithm>  // max, shuffle, sort, swap
+#include <chrono>     // duration, steady_clock
+#include <cstddef>    // ptrdiff_t, size_t
+#include <cstdint>    // int64_t
+#include <cstdlib>    // free, getenv, malloc
+#include <fstream>    // ifstream
+#include <functional> // less
+#include <iostream>   // cerr
+#include <list>       // list
+#include <map>        // map
+#include <memory>     // allocator, allocator_traits, unique_ptr
+#include <memory_resource> // polymorphic_allocator
+#include <mutex>      // lock_guard, mutex
+#include <new>        // bad_alloc
+#include <random>     // mt19937, uniform_int_distribution
+#include <sstream>    // istringstream
+#include <stdexcept>  // runtime_error
+#include <string>     // string
+#include <thread>     // thread
+#include <utility>    // make_pair, pair
+#include <vector>     // vector
+
+#include "benchmark/benchmark.h"
+
+#include "Allocator.h"
+#include "ArenaResource.h"
+#include "ConcurrentAllocator.h"
+
+#if ALLOCATOR_STATS == 0
+// TestAllocator turns the counters on, so this is the build that sees them off
+static_assert(sizeof(Allocator<int, 100>) == 100, "disabled counters must add no bytes");
+#endif
+
+const std::size_t arena = 1 << 16;
+
+// ------
+// Malloc
+// ------
+
+/**
+ * the malloc baseline, an allocator that goes straight to std::malloc and std::free
+ */
+template <typename T>
+class Malloc {
+    public:
+        typedef T              value_type;
+        typedef std::size_t    size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef T*             pointer;
+
+        template <typename U>
+        struct rebind {
+            typedef Malloc<U> other;};
+
+        Malloc () {}
+
+        template <typename U>
+        Malloc (const Malloc<U>&) {}
+
+        pointer allocate (size_type n) {
+            void* p = std::malloc(n * sizeof(T));
+            if (p == nullptr) {
+                throw std::bad_alloc();}
+            return static_cast<pointer>(p);}
+
+        void deallocate (pointer p, size_type) {
+            std::free(p);}
+
+        friend bool operator == (const Malloc&, const Malloc&) {
+            return true;}
+
+        friend bool operator != (const Malloc&, const Malloc&) {
+            return false;}};
+
+// ------
+// shared
+// ------
+
+/**
+ * the one instance of A that every benchmark thread uses
+ */
+template <typename A>
+A& shared () {
+    static A x;
+    return x;}
+
+// -------
+// latency
+// -------
+
+/**
+ * times each round of a benchmark loop and hands it to the manual timer
+ * register the benchmark with UseManualTime()
+ * at the end reports ops per second, and p50_round and p99_round, the percentiles over rounds of a
+ * round's time divided by its ops, in ns
+ * so they're per-round averages (32 ops, or a whole container build), not the latency of single ops
+ * only the first limit rounds are kept for the percentiles
+ * a round should be long enough to hide the cost of reading the clock, see rounds
+ */
+class latency {
+    private:
+        static const std::size_t limit = 1 << 20;
+
+        benchmark::State&                     state;
+        const std::size_t                     ops;
+        std::vector<double>                   t;
+        std::chrono::steady_clock::time_point b;
+
+    public:
+        latency (benchmark::State& s, std::size_t ops) :
+                state (s),
+                ops   (ops) {
+            t.reserve(1 << 16);}
+
+        ~latency () {
+            state.SetItemsProcessed(state.iterations() * ops);
+            if (t.empty()) {
+                return;}
+            std::sort(t.begin(), t.end());
+            state.counters["p50_round"] = t[t.size() / 2]        * 1e9 / ops;
+            state.counters["p99_round"] = t[t.size() * 99 / 100] * 1e9 / ops;}
+
+        void start () {
+            b = std::chrono::steady_clock::now();}
+
+        void stop () {
+            const double d = std::chrono::duration<double>(std::chrono::steady_clock::now() - b).count();
+            state.SetIterationTime(d);
+            if (t.size() != limit) {
+                t.push_back(d);}}};
+
+// ------
+// rounds
+// ------
+
+/**
+ * the ops a single-op benchmark repeats per timed round
+ */
+const int rounds = 32;
+
+// ----
+// line
+// ----
+
+/**
+ * a cache line sized object
+ */
+struct line {
+    char c[64];};
+
+// -------
+// BM_pair
+// -------
+
+/**
+ * allocate/deallocate pairs of state.range(0) objects on an empty arena
+ */
+template <typename A>
+void BM_pair (benchmark::State& state) {
+    std::unique_ptr<A> x(new A);
+    latency l(state, 2 * rounds);
+    for (auto _ : state) {
+        l.start();
+        for (int i = 0; i != rounds; ++i) {
+            typename A::pointer p = x->allocate(state.range(0));
+            benchmark::DoNotOptimize(p);
+            x->deallocate(p, state.range(0));}
+        l.stop();}}
+
+// --------
+// BM_order
+// --------
+
+/**
+ * allocates state.range(0) single objects, then frees them in the order state.range(1) picks
+ * 0 is LIFO, 1 is FIFO and 2 is a fixed random order
+ */
+template <typename A>
+void BM_order (benchmark::State& state) {
+    std::unique_ptr<A> x(new A);
+    std::vector<typename A::pointer> v(state.range(0));
+    std::vector<std::size_t> f(v.size());
+    for (std::size_t i = 0; i != f.size(); ++i) {
+        f[i] = (state.range(1) == 0) ? f.size() - 1 - i : i;}
+    if (state.range(1) == 2) {
+        std::mt19937 g(1);
+        std::shuffle(f.begin(), f.end(), g);}
+    latency l(state, 2 * v.size());
+    for (auto _ : state) {
+        l.start();
+        for (std::size_t i = 0; i != v.size(); ++i) {
+            v[i] = x->allocate(1);}
+        for (std::size_t i = 0; i != f.size(); ++i) {
+            x->deallocate(v[f[i]], 1);}
+        l.stop();}}
+
+// ----
+// fill
+// ----
+
+/**
+ * allocates single objects until N bytes' worth of blocks are pct percent full
+ * the live blocks are what first_fit has to walk past on every allocate
+ * a block is sized the way segregated_fit rounds it, so every policy gets the same count
+ */
+template <std::size_t N, typename A>
+std::vector<typename A::pointer> fill (A& x, int pct) {
+    typedef typename A::value_type value_type;
+    const std::size_t block = std::max(sizeof(value_type), 2 * sizeof(int)) + 2 * sizeof(int);
+    const std::size_t count = (N * pct / 100) / block;
+    std::vector<typename A::pointer> v;
+    v.reserve(count);
+    for (std::size_t i = 0; i != count; ++i) {
+        v.push_back(x.allocate(1));}
+    return v;}
+
+// --------------
+// BM_fill_level
+// --------------
+
+/**
+ * allocate/deallocate pairs on top of an arena of N bytes that is state.range(0) percent full
+ * std::allocator and malloc get the same live blocks
+ */
+template <typename A, std::size_t N>
+void BM_fill_level (benchmark::State& state) {
+    std::unique_ptr<A> x(new A);
+    const std::vector<typename A::pointer> v = fill<N>(*x, state.range(0));
+    latency l(state, 2 * rounds);
+    for (auto _ : state) {
+        l.start();
+        for (int i = 0; i != rounds; ++i) {
+            typename A::pointer p = x->allocate(4);
+            benchmark::DoNotOptimize(p);
+            x->deallocate(p, 4);}
+        l.stop();}
+    state.counters["live"] = v.size();
+    for (std::size_t i = 0; i != v.size(); ++i) {
+        x->deallocate(v[i], 1);}}
+
+// -------------
+// BM_fill_churn
+// -------------
+
+/**
+ * frees every other live block and reallocates it, with an arena of N bytes state.range(0) percent full
+ * first_fit has to walk up to the hole, segregated_fit pops it off its list
+ */
+template <typename A, std::size_t N>
+void BM_fill_churn (benchmark::State& state) {
+    std::unique_ptr<A> x(new A);
+    std::vector<typename A::pointer> v = fill<N>(*x, state.range(0));
+    std::size_t i = v.size() - 1;
+    latency l(state, 2 * rounds);
+    for (auto _ : state) {
+        l.start();
+        for (int j = 0; j != rounds; ++j) {
+            x->deallocate(v[i], 1);
+            v[i] = x->allocate(1);
+            i = (i < 2) ? v.size() - 1 : i - 2;}
+        l.stop();}
+    for (std::size_t j = 0; j != v.size(); ++j) {
+        x->deallocate(v[j], 1);}}
+
+// -------------
+// register_fill
+// -------------
+
+/**
+ * registers BM_fill_level and BM_fill_churn for objects of type T, named by name, with N bytes filled
+ * against std::allocator, malloc and first_fit and segregated_fit arenas of N bytes
+ */
+template <typename T, std::size_t N>
+void register_fill (const std::string& name) {
+    benchmark::RegisterBenchmark(("BM_fill_level<" + name + ">/std::allocator").c_str(),
+                                 BM_fill_level<std::allocator<T>, N>)
+                                 ->Arg(0)->Arg(25)->Arg(50)->Arg(75)->Arg(90)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_fill_level<" + name + ">/malloc").c_str(),
+                                 BM_fill_level<Malloc<T>, N>)
+                                 ->Arg(0)->Arg(25)->Arg(50)->Arg(75)->Arg(90)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_fill_level<" + name + ">/Allocator").c_str(),
+                                 BM_fill_level<Allocator<T, N>, N>)
+                                 ->Arg(0)->Arg(25)->Arg(50)->Arg(75)->Arg(90)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_fill_level<" + name + ">/Allocator<segregated_fit>").c_str(),
+                                 BM_fill_level<Allocator<T, N, segregated_fit>, N>)
+                                 ->Arg(0)->Arg(25)->Arg(50)->Arg(75)->Arg(90)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_fill_churn<" + name + ">/std::allocator").c_str(),
+                                 BM_fill_churn<std::allocator<T>, N>)
+                                 ->Arg(25)->Arg(50)->Arg(75)->Arg(90)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_fill_churn<" + name + ">/malloc").c_str(),
+                                 BM_fill_churn<Malloc<T>, N>)
+                                 ->Arg(25)->Arg(50)->Arg(75)->Arg(90)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_fill_churn<" + name + ">/Allocator").c_str(),
+                                 BM_fill_churn<Allocator<T, N>, N>)
+                                 ->Arg(25)->Arg(50)->Arg(75)->Arg(90)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_fill_churn<" + name + ">/Allocator<segregated_fit>").c_str(),
+                                 BM_fill_churn<Allocator<T, N, segregated_fit>, N>)
+                                 ->Arg(25)->Arg(50)->Arg(75)->Arg(90)->UseManualTime();}
+
+// ---------------
+// container_arena
+// ---------------
+
+const std::size_t container_arena = 1 << 20;
+
+typedef ArenaResource<container_arena, first_fit,      check_none> first_resource;
+typedef ArenaResource<container_arena, segregated_fit, check_none> segregated_resource;
+
+// -----
+// maker
+// -----
+
+/**
+ * the allocator a container benchmark hands its container
+ * a default A, or a handle on the shared resource for the arena-backed ones
+ */
+template <typename A>
+struct maker {
+    static A make () {
+        return A();}};
+
+template <typename T, typename R>
+struct maker<ArenaAllocator<T, R> > {
+    static ArenaAllocator<T, R> make () {
+        return ArenaAllocator<T, R>(shared<R>());}};
+
+template <typename T>
+struct maker<std::pmr::polymorphic_allocator<T> > {
+    static std::pmr::polymorphic_allocator<T> make () {
+        return &shared<segregated_resource>();}};
+
+// ---------
+// BM_vector
+// ---------
+
+/**
+ * push_backs state.range(0) objects onto an empty std::vector, then destroys it
+ */
+template <typename A>
+void BM_vector (benchmark::State& state) {
+    typedef typename A::value_type value_type;
+    latency l(state, state.range(0));
+    for (auto _ : state) {
+        l.start();
+        {
+        std::vector<value_type, A> v(maker<A>::make());
+        for (int i = 0; i != state.range(0); ++i) {
+            v.push_back(value_type());}
+        benchmark::DoNotOptimize(v.data());
+        }
+        l.stop();}}
+
+// -------
+// BM_list
+// -------
+
+/**
+ * push_backs state.range(0) objects onto an empty std::list, then destroys it
+ */
+template <typename A>
+void BM_list (benchmark::State& state) {
+    typedef typename A::value_type value_type;
+    latency l(state, state.range(0));
+    for (auto _ : state) {
+        l.start();
+        {
+        std::list<value_type, A> v(maker<A>::make());
+        for (int i = 0; i != state.range(0); ++i) {
+            v.push_back(value_type());}
+        benchmark::DoNotOptimize(&v.back());
+        }
+        l.stop();}}
+
+// ------
+// BM_map
+// ------
+
+/**
+ * inserts state.range(0) shuffled int keys, mapped to objects, into an empty std::map, then destroys it
+ */
+template <typename A>
+void BM_map (benchmark::State& state) {
+    typedef typename A::value_type value_type;
+    typedef typename std::allocator_traits<A>::template rebind_alloc<std::pair<const int, value_type> > B;
+    std::vector<int> k(state.range(0));
+    for (std::size_t i = 0; i != k.size(); ++i) {
+        k[i] = i;}
+    std::mt19937 g(1);
+    std::shuffle(k.begin(), k.end(), g);
+    latency l(state, k.size());
+    for (auto _ : state) {
+        l.start();
+        {
+        std::map<int, value_type, std::less<int>, B> m(maker<A>::make());
+        for (std::size_t i = 0; i != k.size(); ++i) {
+            m.insert(std::make_pair(k[i], value_type()));}
+        benchmark::DoNotOptimize(&*m.begin());
+        }
+        l.stop();}}
+
+// ------------------
+// register_container
+// ------------------
+
+/**
+ * registers BM_vector, BM_list and BM_map with allocator A, named by name and by
+ */
+template <typename A>
+void register_container (const std::string& name, const std::string& by) {
+    benchmark::RegisterBenchmark(("BM_vector<" + name + ">/" + by).c_str(),
+                                 BM_vector<A>)->Arg(64)->Arg(1024)->Arg(4096)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_list<"   + name + ">/" + by).c_str(),
+                                 BM_list<A>)  ->Arg(64)->Arg(1024)->Arg(4096)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_map<"    + name + ">/" + by).c_str(),
+                                 BM_map<A>)   ->Arg(64)->Arg(1024)->Arg(4096)->UseManualTime();}
+
+// ---------------
+// register_object
+// ---------------
+
+/**
+ * registers the per-type benchmarks for objects of type T, named by name
+ * BM_pair, BM_order and the fill benchmarks against std::allocator, malloc and arenas of several sizes
+ * the containers against std::allocator, malloc, first_fit and segregated_fit resources of two sizes,
+ * and a polymorphic_allocator
+ */
+template <typename T>
+void register_object (const std::string& name) {
+    const std::vector<std::int64_t> live  = {16, 256, 1024};
+    const std::vector<std::int64_t> order = {0, 1, 2};
+    benchmark::RegisterBenchmark(("BM_pair<" + name + ">/std::allocator").c_str(),
+                                 BM_pair<std::allocator<T> >)->Arg(1)->Arg(8)->Arg(32)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_pair<" + name + ">/malloc").c_str(),
+                                 BM_pair<Malloc<T> >)->Arg(1)->Arg(8)->Arg(32)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_pair<" + name + ">/Allocator<1<<12>").c_str(),
+                                 BM_pair<Allocator<T, 1 << 12> >)->Arg(1)->Arg(8)->Arg(32)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_pair<" + name + ">/Allocator<1<<16>").c_str(),
+                                 BM_pair<Allocator<T, 1 << 16> >)->Arg(1)->Arg(8)->Arg(32)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_pair<" + name + ">/Allocator<1<<20>").c_str(),
+                                 BM_pair<Allocator<T, 1 << 20> >)->Arg(1)->Arg(8)->Arg(32)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_pair<" + name + ">/Allocator<1<<16,segregated_fit>").c_str(),
+                                 BM_pair<Allocator<T, 1 << 16, segregated_fit> >)->Arg(1)->Arg(8)->Arg(32)
+                                 ->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_order<" + name + ">/std::allocator").c_str(),
+                                 BM_order<std::allocator<T> >)->ArgsProduct({live, order})
+                                 ->ArgNames({"live", "order"})->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_order<" + name + ">/malloc").c_str(),
+                                 BM_order<Malloc<T> >)->ArgsProduct({live, order})
+                                 ->ArgNames({"live", "order"})->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_order<" + name + ">/Allocator<1<<17>").c_str(),
+                                 BM_order<Allocator<T, 1 << 17> >)->ArgsProduct({live, order})
+                                 ->ArgNames({"live", "order"})->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_order<" + name + ">/Allocator<1<<17,segregated_fit>").c_str(),
+                                 BM_order<Allocator<T, 1 << 17, segregated_fit> >)->ArgsProduct({live, order})
+                                 ->ArgNames({"live", "order"})->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_order<" + name + ">/Allocator<1<<17,fixed_pool>").c_str(),
+                                 BM_order<Allocator<T, 1 << 17, fixed_pool> >)->ArgsProduct({live, order})
+                                 ->ArgNames({"live", "order"})->UseManualTime();;
+    register_fill<T, 1 << 12>(name + ",1<<12");
+    register_fill<T, 1 << 16>(name + ",1<<16");
+    register_fill<T, 1 << 20>(name + ",1<<20");
+    register_container<std::allocator<T> >                                 (name, "std::allocator");
+    register_container<Malloc<T> >                                         (name, "malloc");
+    register_container<ArenaAllocator<T, first_resource> >                 (name, "first_fit<1<<20>");
+    register_container<ArenaAllocator<T, segregated_resource> >            (name, "segregated_fit<1<<20>");
+    register_container<ArenaAllocator<T, ArenaResource<1 << 22, first_fit,      check_none> > >
+                                                                           (name, "first_fit<1<<22>");
+    register_container<ArenaAllocator<T, ArenaResource<1 << 22, segregated_fit, check_none> > >
+                                                                           (name, "segregated_fit<1<<22>");
+    register_container<std::pmr::polymorphic_allocator<T> >                (name, "pmr");}
+
+// -------
+// request
+// -------
+
+/**
+ * the object counts of the blocks a request allocates, a fixed mix of [1, 16]
+ */
+std::vector<int> request (std::size_t blocks) {
+    std::mt19937 g(3);
+    std::uniform_int_distribution<int> n(1, 16);
+    std::vector<int> z(blocks);
+    for (std::size_t i = 0; i != z.size(); ++i) {
+        z[i] = n(g);}
+    return z;}
+
+// ---------------
+// BM_request_free
+// ---------------
+
+/**
+ * one request: allocates state.range(0) blocks, then frees each one, last first
+ * a round is one request, so p50_round and p99_round are per request
+ * with trusted, the frees go through Allocator's deallocate_trusted
+ */
+template <typename A, bool trusted = false>
+void BM_request_free (benchmark::State& state) {
+    std::unique_ptr<A> x(new A);
+    const std::vector<int> z = request(state.range(0));
+    std::vector<typename A::pointer> v(z.size());
+    latency l(state, 1);
+    for (auto _ : state) {
+        l.start();
+        for (std::size_t i = 0; i != v.size(); ++i) {
+            v[i] = x->allocate(z[i]);}
+        for (std::size_t i = v.size(); i != 0; --i) {
+            if constexpr (trusted) {
+                x->deallocate_trusted(v[i - 1], z[i - 1]);}
+            else {
+                x->deallocate(v[i - 1], z[i - 1]);}}
+        l.stop();}}
+
+// ----------------
+// BM_request_reset
+// ----------------
+
+/**
+ * the same request, ended by a single reset()
+ */
+template <typename A>
+void BM_request_reset (benchmark::State& state) {
+    std::unique_ptr<A> x(new A);
+    const std::vector<int> z = request(state.range(0));
+    latency l(state, 1);
+    for (auto _ : state) {
+        l.start();
+        for (std::size_t i = 0; i != z.size(); ++i) {
+            benchmark::DoNotOptimize(x->allocate(z[i]));}
+        x->reset();
+        l.stop();}}
+
+BENCHMARK_TEMPLATE(BM_request_free,  std::allocator<int>)
+    ->Arg(16)->Arg(256)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_request_free,  Malloc<int>)
+    ->Arg(16)->Arg(256)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_request_free,  Allocator<int, arena, first_fit,      check_full>)
+    ->Arg(16)->Arg(256)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_request_free,  Allocator<int, arena, first_fit,      check_full>, true)
+    ->Arg(16)->Arg(256)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_request_free,  Allocator<int, arena, segregated_fit, check_full>)
+    ->Arg(16)->Arg(256)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_request_free,  Allocator<int, arena, segregated_fit, check_full>, true)
+    ->Arg(16)->Arg(256)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_request_reset, Allocator<int, arena, first_fit>)
+    ->Arg(16)->Arg(256)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_request_reset, Allocator<int, arena, segregated_fit>)
+    ->Arg(16)->Arg(256)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_request_reset, Allocator<int, arena, monotonic>)
+    ->Arg(16)->Arg(256)->UseManualTime();
+
+// --------
+// BM_batch
+// --------
+
+/**
+ * state.range(0) blocks of 4 objects through allocate_batch and deallocate_batch
+ */
+template <typename A>
+void BM_batch (benchmark::State& state) {
+    std::unique_ptr<A> x(new A);
+    std::vector<typename A::pointer> v(state.range(0));
+    for (auto _ : state) {
+        x->allocate_batch(4, v.size(), v.data());
+        x->deallocate_batch(v.data(), v.size(), 4);}
+    state.SetItemsProcessed(state.iterations() * v.size());}
+
+// -------------
+// BM_individual
+// -------------
+
+/**
+ * the same blocks as BM_batch, one allocate and one deallocate call at a time
+ */
+template <typename A>
+void BM_individual (benchmark::State& state) {
+    std::unique_ptr<A> x(new A);
+    std::vector<typename A::pointer> v(state.range(0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i != v.size(); ++i) {
+            v[i] = x->allocate(4);}
+        for (std::size_t i = 0; i != v.size(); ++i) {
+            x->deallocate(v[i], 4);}}
+    state.SetItemsProcessed(state.iterations() * v.size());}
+
+BENCHMARK_TEMPLATE(BM_batch,      Allocator<int, arena>)
+    ->Arg(16)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_individual, Allocator<int, arena>)
+    ->Arg(16)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_batch,      Allocator<int, arena, segregated_fit>)
+    ->Arg(16)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_individual, Allocator<int, arena, segregated_fit>)
+    ->Arg(16)->Arg(256)->Arg(1024);
+
+// ------
+// Locked
+// ------
+
+/**
+ * an arena shared the only way Allocator allows, behind one mutex
+ */
+template <typename A>
+class Locked {
+    public:
+        typedef typename A::value_type value_type;
+        typedef typename A::size_type  size_type;
+        typedef typename A::pointer    pointer;
+
+    private:
+        A          x;
+        std::mutex m;
+
+    public:
+        pointer allocate (size_type n) {
+            std::lock_guard<std::mutex> g(m);
+            return x.allocate(n);}
+
+        void deallocate (pointer p, size_type n) {
+            std::lock_guard<std::mutex> g(m);
+            x.deallocate(p, n);}};
+
+// ----------
+// BM_threads
+// ----------
+
+/**
+ * each thread allocates 64 single objects from the shared allocator and frees them in LIFO order
+ */
+template <typename A>
+void BM_threads (benchmark::State& state) {
+    A& x = shared<A>();
+    std::vector<typename A::pointer> v(64);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i != v.size(); ++i) {
+            v[i] = x.allocate(1);}
+        for (std::size_t i = v.size(); i != 0; --i) {
+            x.deallocate(v[i - 1], 1);}}
+    state.SetItemsProcessed(state.iterations() * v.size());}
+
+const int cores = std::max(1u, std::thread::hardware_concurrency());
+
+const std::size_t big_arena = 1 << 22;
+
+BENCHMARK_TEMPLATE(BM_threads, std::allocator<int>)
+    ->ThreadRange(1, cores)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_threads, Locked<Allocator<int, big_arena, segregated_fit> >)
+    ->ThreadRange(1, cores)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_threads, ConcurrentAllocator<int, big_arena>)
+    ->ThreadRange(1, cores)->UseRealTime();
+
+// --
+// op
+// --
+
+/**
+ * one step of an allocation trace: allocate n objects as block id, or free block id if n is 0
+ */
+struct op {
+    int id;
+    int n;};
+
+// ---------
+// synthetic
+// ---------
+
+/**
+ * a reproducible random trace of about ops steps that keeps around live blocks outstanding
+ * small percent of the requests are for [1, 4] objects, the rest for [16, large]
+ * every block is freed by the end
+ */
+std::vector<op> synthetic (unsigned seed, int ops, int live, int small, int large) {
+    std::mt19937 g(seed);
+    std::uniform_int_distribution<int> coin(0, 99);
+    std::uniform_int_distribution<int> little(1, 4);
+    std::uniform_int_distribution<int> big(16, large);
+    std::vector<op> t;
+    std::vector<int> out;
+    int id = 0;
+    for (int i = 0; i != ops; ++i) {
+        const int grow = (int)out.size() < live ? 60 : 40;
+        if (out.empty() || coin(g) < grow) {
+            t.push_back(op{id, coin(g) < small ? little(g) : big(g)});
+            out.push_back(id++);}
+        else {
+            std::uniform_int_distribution<std::size_t> pick(0, out.size() - 1);
+            std::swap(out[pick(g)], out.back());
+            t.push_back(op{out.back(), 0});
+            out.pop_back();}}
+    while (!out.empty()) {
+        t.push_back(op{out.back(), 0});
+        out.pop_back();}
+    return t;}
+
+// ----
+// load
+// ----
+
+/**
+ * a recorded trace, one "a <id> <n>" or "f <id>" per line, blank lines are skipped
+ * ids index the replay's block table, so they have to be in [0, ids)
+ * an id can only be allocated while it isn't live, and only freed while it is
+ * blocks still live at the end get freed there, so every replay starts on an empty arena
+ * throw a runtime_error exception, naming the file and line, if the file can't be read or a line is bad
+ */
+std::vector<op> load (const char* path) {
+    const int ids = 1 << 24;
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error(std::string(path) + ": can't open the trace");}
+    std::vector<op> t;
+    std::vector<bool> live;
+    std::string s;
+    for (int l = 1; std::getline(in, s); ++l) {
+        std::istringstream r(s);
+        std::string c;
+        op o = {0, 0};
+        if (!(r >> c)) {
+            continue;}
+        const bool ok = (c == "a" && r >> o.id >> o.n && o.n > 0) || (c == "f" && r >> o.id);
+        std::string rest;
+        if (!ok || r >> rest || o.id < 0 || o.id >= ids) {
+            throw std::runtime_error(std::string(path) + ":" + std::to_string(l) + ": bad line \"" + s + "\"");}
+        if ((std::size_t)o.id >= live.size()) {
+            live.resize(o.id + 1, false);}
+        if (live[o.id] == (c == "a")) {
+            throw std::runtime_error(std::string(path) + ":" + std::to_string(l) + ": block " + std::to_string(o.id) +
+                                     (c == "a" ? " is already live" : " isn't live"));}
+        live[o.id] = c == "a";
+        t.push_back(o);}
+    if (in.bad()) {
+        throw std::runtime_error(std::string(path) + ": can't read the trace");}
+    for (std::size_t i = 0; i != live.size(); ++i) {
+        if (live[i]) {
+            t.push_back(op{(int)i, 0});}}
+    return t;}
+
+// ------
+// replay
+// ------
+
+/**
+ * runs trace t against x, returns the number of allocations that threw bad_alloc
+ * a block whose allocation failed isn't freed
+ * if frag isn't null, it gets the fragmentation averaged over every 64th step
+ */
+template <typename A>
+int replay (A& x, const std::vector<op>& t, std::vector<typename A::pointer>& b, std::vector<int>& z,
+            double* frag) {
+    int failed  = 0;
+    int samples = 0;
+    double sum  = 0;
+    for (std::size_t i = 0; i != t.size(); ++i) {
+        const op& o = t[i];
+        if (o.n != 0) {
+            try {
+                b[o.id] = x.allocate(o.n);
+                z[o.id] = o.n;}
+            catch (const std::bad_alloc&) {
+                b[o.id] = nullptr;
+                ++failed;}}
+        else if (b[o.id] != nullptr) {
+            x.deallocate(b[o.id], z[o.id]);
+            b[o.id] = nullptr;}
+        if (frag != nullptr && i % 64 == 0) {
+            sum += x.stats().fragmentation;
+            ++samples;}}
+    if (frag != nullptr) {
+        *frag = samples == 0 ? 0 : sum / samples;}
+    return failed;}
+
+// --------
+// BM_trace
+// --------
+
+/**
+ * replays a trace against a fresh arena per policy
+ * reports steps per second, the average external fragmentation and the failed allocations
+ * built with -DALLOCATOR_STATS=1, also the blocks each search looked at, on average
+ */
+template <typename A>
+void BM_trace (benchmark::State& state, const std::vector<op>* t) {
+    std::unique_ptr<A> x(new A);
+    int ids = 0;
+    for (std::size_t i = 0; i != t->size(); ++i) {
+        ids = std::max(ids, (*t)[i].id + 1);}
+    std::vector<typename A::pointer> b(ids, nullptr);
+    std::vector<int> z(ids, 0);
+    double frag;
+    const int failed = replay(*x, *t, b, z, &frag);
+    for (auto _ : state) {
+        replay(*x, *t, b, z, nullptr);}
+    state.SetItemsProcessed(state.iterations() * t->size());
+    state.counters["frag"]   = frag;
+    state.counters["failed"] = failed;
+    const allocator_stats r = x->stats();
+    if (r.searches != 0) {                          // only with ALLOCATOR_STATS
+        state.counters["scanned"] = (double)r.scanned / r.searches;}}
+
+// --------------
+// register_trace
+// --------------
+
+/**
+ * registers BM_trace for every placement policy on trace t
+ */
+void register_trace (const std::string& name, const std::vector<op>* t) {
+    benchmark::RegisterBenchmark(("BM_trace<first_fit>/"      + name).c_str(),
+                                 BM_trace<Allocator<int, arena, first_fit> >,      t);
+    benchmark::RegisterBenchmark(("BM_trace<next_fit>/"       + name).c_str(),
+                                 BM_trace<Allocator<int, arena, next_fit> >,       t);
+    benchmark::RegisterBenchmark(("BM_trace<best_fit<>>/"     + name).c_str(),
+                                 BM_trace<Allocator<int, arena, best_fit<> > >,    t);
+    benchmark::RegisterBenchmark(("BM_trace<best_fit<8>>/"    + name).c_str(),
+                                 BM_trace<Allocator<int, arena, best_fit<8> > >,   t);
+    benchmark::RegisterBenchmark(("BM_trace<segregated_fit>/" + name).c_str(),
+                                 BM_trace<Allocator<int, arena, segregated_fit> >, t);}
+
+// ----
+// main
+// ----
+
+/**
+ * registers the per-type benchmarks and the traces
+ * ALLOCATOR_TRACE names a recorded trace to replay alongside the synthetic ones, a trace that won't
+ * load is reported and nothing runs
+ */
+int main (int argc, char** argv) {
+    const std::vector<op> churn   = synthetic(1, 20000, 1000, 100, 16);
+    const std::vector<op> bimodal = synthetic(2, 20000,  400,  80, 128);
+    register_object<int>   ("int");
+    register_object<double>("double");
+    register_object<line>  ("line");
+    register_trace("churn",   &churn);
+    register_trace("bimodal", &bimodal);
+    std::vector<op> recorded;
+    if (const char* path = std::getenv("ALLOCATOR_TRACE")) {
+        try {
+            recorded = load(path);}
+        catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;}
+        register_trace("recorded", &recorded);}
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;}
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;}
@@ -0,0 +1,313 @@
+// -------------------------------------
+// projects/allocator/ChunkedAllocator.h
+// Copyright (C) 2015
+// Glenn P. Downing
+// -------------------------------------
+
+#ifndef ChunkedAllocator_h
+#define ChunkedAllocator_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>  // upper_bound
+#include <cstddef>    // ptrdiff_t, size_t
+#include <functional> // less
+#include <new>        // bad_alloc, new
+#include <stdexcept>  // invalid_argument
+#include <utility>    // swap
+#include <vector>     // vector
+
+#include <sys/mman.h> // mmap, munmap
+#include <unistd.h>   // sysconf
+
+#include "Allocator.h"
+
+// ----------------
+// ChunkedAllocator
+// ----------------
+
+/**
+ * an arena sized at run time, made of chunks mapped from the OS
+ * each chunk is an Allocator<T, M, P, C, A> built in its own anonymous mapping, so it keeps the
+ * same sentinels, coalescing and checks
+ * when no chunk can satisfy a request another one is mapped
+ * a chunk that becomes empty is unmapped while more than high_water bytes are mapped
+ * no request can be larger than a chunk
+ * owns its chunks, so it can be moved but not copied
+ */
+template <typename T, std::size_t M = (1 << 16), typename P = segregated_fit, check_level C = ALLOCATOR_CHECK_LEVEL,
+          std::size_t A = alignof(T)>
+class ChunkedAllocator {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T                 value_type;
+
+        typedef std::size_t       size_type;
+        typedef std::ptrdiff_t    difference_type;
+
+        typedef       value_type*       pointer;
+        typedef const value_type* const_pointer;
+
+        typedef       value_type&       reference;
+        typedef const value_type& const_reference;
+
+        typedef Allocator<T, M, P, C, A> chunk_type;
+
+    public:
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const ChunkedAllocator& lhs, const ChunkedAllocator& rhs) {
+            return &lhs == &rhs;}
+
+        // -----------
+        // operator !=
+        // -----------
+
+        friend bool operator != (const ChunkedAllocator& lhs, const ChunkedAllocator& rhs) {
+            return !(lhs == rhs);}
+
+    private:
+        // ----
+        // data
+        // ----
+
+        std::vector<chunk_type*> c;          // sorted by address
+        std::size_t              current;    // the chunk that satisfied the last allocation
+        size_type                high_water; // bytes of chunks kept mapped when they're empty
+
+        // -----
+        // bytes
+        // -----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the size of one chunk's mapping, a whole number of pages
+         */
+        static size_type bytes () {
+            const size_type page = sysconf(_SC_PAGESIZE);
+            return (sizeof(chunk_type) + page - 1) / page * page;}
+
+        // ---
+        // map
+        // ---
+
+        /**
+         * O(1) in space
+         * O(chunks) in time
+         * maps a new chunk and returns its index in c
+         * the mapping is given back if the chunk can't be built or recorded
+         * throw a bad_alloc exception, if the OS won't map it or M can't hold a block
+         */
+        std::size_t map () {
+            void* v = mmap(nullptr, bytes(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (v == MAP_FAILED) {
+                throw std::bad_alloc();}
+            try {
+                chunk_type* x = new (v) chunk_type;
+                const typename std::vector<chunk_type*>::iterator i =
+                    c.insert(std::upper_bound(c.begin(), c.end(), x, std::less<chunk_type*>()), x);
+                return i - c.begin();}
+            catch (...) {
+                munmap(v, bytes());
+                throw;}}
+
+        // -----
+        // unmap
+        // -----
+
+        /**
+         * O(1) in space
+         * O(chunks) in time
+         * gives chunk i back to the OS
+         */
+        void unmap (std::size_t i) {
+            c[i]->~chunk_type();
+            munmap(c[i], bytes());
+            c.erase(c.begin() + i);
+            if (current >= c.size() || current > i) {
+                current = current == 0 ? 0 : current - 1;}}
+
+        // ----
+        // find
+        // ----
+
+        /**
+         * O(1) in space
+         * O(log chunks) in time
+         * the index of the chunk p points into
+         * throw an invalid_argument exception, if p isn't in any chunk
+         */
+        std::size_t find (const_pointer p) const {
+            const chunk_type* x = reinterpret_cast<const chunk_type*>(p);
+            const typename std::vector<chunk_type*>::const_iterator i =
+                std::upper_bound(c.begin(), c.end(), x, std::less<const chunk_type*>());
+            if (i == c.begin() ||
+                reinterpret_cast<const char*>(p) >= reinterpret_cast<const char*>(*(i - 1)) + sizeof(chunk_type)) {
+                throw std::invalid_argument("Pointer p is out of bounds");}
+            return i - c.begin() - 1;}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * O(chunks) in space
+         * O(chunks) in time
+         * maps enough chunks for capacity bytes, at least one
+         * empty chunks stay mapped up to high_water bytes, which defaults to what's mapped now
+         * throw a bad_alloc exception, if the OS won't map them or M can't hold a block, nothing stays
+         * mapped then
+         */
+        explicit ChunkedAllocator (size_type capacity = M, size_type high_water = 0) :
+                current    (0),
+                high_water (high_water) {
+            try {
+                do {
+                    map();}
+                while (c.size() * M < capacity);}
+            catch (...) {
+                while (!c.empty()) {
+                    unmap(c.size() - 1);}
+                throw;}
+            if (this->high_water == 0) {
+                this->high_water = c.size() * bytes();}}
+
+        ChunkedAllocator (ChunkedAllocator&& that) :
+                current    (that.current),
+                high_water (that.high_water) {
+            c.swap(that.c);}
+
+        ChunkedAllocator& operator = (ChunkedAllocator&& that) {
+            c.swap(that.c);
+            std::swap(current,    that.current);
+            std::swap(high_water, that.high_water);
+            return *this;}
+
+        ChunkedAllocator             (const ChunkedAllocator&) = delete;
+        ChunkedAllocator& operator = (const ChunkedAllocator&) = delete;
+
+        /**
+         * O(1) in space
+         * O(chunks) in time
+         * unmaps every chunk, anything still allocated goes with them
+         */
+        ~ChunkedAllocator () {
+            while (!c.empty()) {
+                unmap(c.size() - 1);}}
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * O(1) in space
+         * O(1) in time with segregated_fit, when the chunk that satisfied the last request has room
+         * otherwise every other chunk is probed with try_allocate, then a new one is mapped
+         * throw a bad_alloc exception, if n objects won't fit in an empty chunk or the OS won't map one
+         */
+        pointer allocate (size_type n) {
+            if (n == 0) {
+                return nullptr;}
+            if (n > M / sizeof(T)) {
+                throw std::bad_alloc();}
+            for (std::size_t k = 0; k != c.size(); ++k) {
+                const std::size_t i = (current + k) % c.size();
+                const pointer p = c[i]->try_allocate(n);
+                if (p != nullptr) {
+                    current = i;
+                    return p;}}
+            const std::size_t i = map();
+            const pointer p = c[i]->try_allocate(n);
+            if (p == nullptr) {
+                unmap(i);
+                throw std::bad_alloc();}
+            current = i;
+            return p;}
+
+        // ---------
+        // construct
+        // ---------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        void construct (pointer p, const_reference v) {
+            new (p) T(v);}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(log chunks) in time
+         * frees p in its chunk, and unmaps the chunk if that empties it and more than high_water
+         * bytes are mapped
+         * throw an invalid_argument exception, if p is invalid
+         */
+        void deallocate (pointer p, size_type n) {
+            const std::size_t i = find(p);
+            c[i]->deallocate(p, n);
+            if (c[i]->empty() && c.size() > 1 && c.size() * bytes() > high_water) {
+                unmap(i);}}
+
+        // -------
+        // destroy
+        // -------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        void destroy (pointer p) {
+            p->~T();}
+
+        // ------
+        // chunks
+        // ------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the chunks mapped now
+         */
+        std::size_t chunks () const {
+            return c.size();}
+
+        // ------
+        // mapped
+        // ------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the bytes mapped now
+         */
+        size_type mapped () const {
+            return c.size() * bytes();}
+
+        // ----------
+        // check_heap
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * runs check_heap() on every chunk
+         */
+        bool check_heap () const {
+            for (std::size_t i = 0; i != c.size(); ++i) {
+                c[i]->check_heap();}
+            return true;}};
+
+#endif // ChunkedAllocator_h
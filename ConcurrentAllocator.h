@@ -0,0 +1,461 @@
+// ----------------------------------------
+// projects/allocator/ConcurrentAllocator.h
+// Copyright (C) 2015
+// Glenn P. Downing
+// ----------------------------------------
+
+#ifndef ConcurrentAllocator_h
+#define ConcurrentAllocator_h
+
+// --------
+// includes
+// --------
+
+#include <atomic>    // atomic
+#include <cstddef>   // ptrdiff_t, size_t
+#include <mutex>     // lock_guard, mutex
+#include <new>       // bad_alloc, new
+#include <stdexcept> // invalid_argument
+
+#include "Allocator.h"
+
+// -----------------
+// allocator_threads
+// -----------------
+
+/**
+ * the number of threads that can have a cache at the same time
+ * threads past this go straight to the shared arena
+ */
+const int allocator_threads = 64;
+
+// ---------------------
+// allocator_thread_slot
+// ---------------------
+
+/**
+ * claims the lowest free id in [0, allocator_threads) for the life of a thread, -1 if there is none
+ * the id goes back to the pool when the thread exits
+ * claim and release let a thread hold one more id for a moment, while it cleans up after an exited one
+ */
+struct allocator_thread_slot {
+    int id;
+
+    static std::atomic<unsigned long long>& ids () {
+        static std::atomic<unsigned long long> m(0);
+        return m;}
+
+    static bool claim (int k) {
+        unsigned long long m = ids().load();
+        do {
+            if (m & (1ull << k)) {
+                return false;}}
+        while (!ids().compare_exchange_weak(m, m | (1ull << k)));
+        return true;}
+
+    static void release (int k) {
+        ids().fetch_and(~(1ull << k));}
+
+    allocator_thread_slot () :
+            id (-1) {
+        unsigned long long m = ids().load();
+        int k;
+        do {
+            if (~m == 0) {
+                return;}
+            k = __builtin_ctzll(~m);}
+        while (!ids().compare_exchange_weak(m, m | (1ull << k)));
+        id = k;}
+
+    ~allocator_thread_slot () {
+        if (id != -1) {
+            release(id);}}};
+
+// -------------------
+// allocator_thread_id
+// -------------------
+
+/**
+ * O(1) in space
+ * O(1) in time
+ * the calling thread's id, -1 if it didn't get one
+ */
+inline int allocator_thread_id () {
+    static thread_local allocator_thread_slot s;
+    return s.id;}
+
+// -------------------
+// ConcurrentAllocator
+// -------------------
+
+/**
+ * a thread-safe front end over one shared Allocator<T, N, P, C, A> arena
+ * single objects come from a per-thread magazine of cached blocks, refilled from and flushed to the
+ * arena in batches under a mutex
+ * a single object freed by a thread other than the one whose magazine it came from goes onto the
+ * owner's inbox, a lock-free stack that the owner drains on its next refill
+ * everything else, and every thread without an id, takes the mutex and goes to the arena
+ * a thread that exits leaves its magazine and inbox to the next thread that gets its id, or, if the
+ * arena runs out first, to reclaim()
+ * owns its arena, so it can't be copied
+ */
+template <typename T, std::size_t N, typename P = segregated_fit, check_level C = ALLOCATOR_CHECK_LEVEL,
+          std::size_t A = alignof(T)>
+class ConcurrentAllocator {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T                 value_type;
+
+        typedef std::size_t       size_type;
+        typedef std::ptrdiff_t    difference_type;
+
+        typedef       value_type*       pointer;
+        typedef const value_type* const_pointer;
+
+        typedef       value_type&       reference;
+        typedef const value_type& const_reference;
+
+        typedef Allocator<T, N, P, C, A> arena_type;
+
+    public:
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const ConcurrentAllocator& lhs, const ConcurrentAllocator& rhs) {
+            return &lhs == &rhs;}
+
+        // -----------
+        // operator !=
+        // -----------
+
+        friend bool operator != (const ConcurrentAllocator& lhs, const ConcurrentAllocator& rhs) {
+            return !(lhs == rhs);}
+
+    private:
+        // ---------
+        // constants
+        // ---------
+
+        static const int magazine = 32;           // blocks a thread caches
+        static const int batch    = magazine / 2; // blocks moved per refill or flush
+
+        // a cached block must be able to hold the inbox link
+        static const size_type cell = (sizeof(int) + sizeof(T) - 1) / sizeof(T);
+
+        static const unsigned char shared = 0xFF; // owner of a block that isn't in any cache
+        static const unsigned char cached = 0x80; // or'd into the owner while the block is cached, not live
+
+        // -----
+        // cache
+        // -----
+
+        /**
+         * blocks and count are only touched by the thread whose id this is
+         * inbox is the offset of the first block freed to it by other threads, -1 if none
+         * one per cache line, so neighbouring threads don't share
+         */
+        struct alignas(64) cache {
+            pointer          blocks[magazine];
+            int              count;
+            std::atomic<int> inbox;
+
+            cache () :
+                    count (0),
+                    inbox (-1)
+                {}};
+
+        // ----
+        // data
+        // ----
+
+        arena_type    arena;
+        std::mutex    lock;
+        cache         caches[allocator_threads];
+        unsigned char owner[sizeof(arena_type) / sizeof(int) + 1]; // by offset / sizeof(int)
+
+        // ------
+        // offset
+        // ------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * p's offset from the start of the arena
+         */
+        int offset (const_pointer p) const {
+            return reinterpret_cast<const char*>(p) - reinterpret_cast<const char*>(&arena);}
+
+        pointer at (int o) {
+            return reinterpret_cast<pointer>(reinterpret_cast<char*>(&arena) + o);}
+
+        // ----
+        // next
+        // ----
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the inbox link stored in the first int of a freed block
+         */
+        static int& next (pointer p) {
+            return *reinterpret_cast<int*>(p);}
+
+        // -------
+        // objects
+        // -------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         * the objects taken from the arena for a request of n
+         */
+        static size_type objects (size_type n) {
+            return n == 1 ? (size_type)cell : n;}
+
+        // -------
+        // reclaim
+        // -------
+
+        /**
+         * O(1) in space
+         * O(allocator_threads * magazine) in time, plus the inboxes
+         * called with the mutex held, when the arena can't satisfy a request
+         * gives the magazines and inboxes of ids that no thread holds back to the arena
+         * each id is claimed while it's drained, so a new thread can't take it halfway through
+         * returns whether any block came back
+         */
+        bool reclaim () {
+            bool r = false;
+            for (int t = 0; t != allocator_threads; ++t) {
+                if (!allocator_thread_slot::claim(t)) {
+                    continue;}
+                cache& c = caches[t];
+                int o = c.inbox.exchange(-1, std::memory_order_acquire);
+                r = r || o != -1 || c.count != 0;
+                while (o != -1) {
+                    pointer p = at(o);
+                    o = next(p);
+                    owner[offset(p) / sizeof(int)] = shared;
+                    arena.deallocate(p, objects(1));}
+                for (int i = 0; i != c.count; ++i) {
+                    owner[offset(c.blocks[i]) / sizeof(int)] = shared;}
+                if (c.count != 0) {
+                    arena.deallocate_batch(c.blocks, c.count, objects(1));
+                    c.count = 0;}
+                allocator_thread_slot::release(t);}
+            return r;}
+
+        // ----
+        // take
+        // ----
+
+        /**
+         * O(1) in space
+         * O(magazine) in time, plus one allocate_batch
+         * called with the mutex held and an empty magazine
+         * takes batch blocks from the arena, or as many as are left
+         */
+        void take (cache& c) {
+            try {
+                arena.allocate_batch(objects(1), batch, c.blocks);
+                c.count = batch;}
+            catch (const std::bad_alloc&) {
+                while (c.count != batch) {
+                    const pointer p = arena.try_allocate(objects(1));
+                    if (p == nullptr) {
+                        break;}
+                    c.blocks[c.count++] = p;}}}
+
+        // ------
+        // refill
+        // ------
+
+        /**
+         * O(1) in space
+         * O(magazine) in time, plus one allocate_batch under the mutex
+         * called with an empty magazine, drains the inbox into it
+         * if that leaves it empty, takes batch blocks from the arena, or as many as are left, reclaiming
+         * the caches of exited threads if there are none
+         * what doesn't fit in the magazine goes back to the arena
+         */
+        void refill (cache& c, int t) {
+            int o = c.inbox.exchange(-1, std::memory_order_acquire);
+            while (o != -1 && c.count != magazine) {
+                pointer p = at(o);
+                o = next(p);
+                c.blocks[c.count++] = p;}
+            if (o == -1 && c.count != 0) {
+                return;}
+            std::lock_guard<std::mutex> g(lock);
+            while (o != -1) {
+                pointer p = at(o);
+                o = next(p);
+                owner[offset(p) / sizeof(int)] = shared;
+                arena.deallocate(p, objects(1));}
+            if (c.count != 0) {
+                return;}
+            take(c);
+            if (c.count == 0 && reclaim()) {
+                take(c);}
+            for (int i = 0; i != c.count; ++i) {
+                owner[offset(c.blocks[i]) / sizeof(int)] = t | cached;}}
+
+        // -----
+        // flush
+        // -----
+
+        /**
+         * O(1) in space
+         * O(magazine) in time, plus one deallocate_batch under the mutex
+         * called with a full magazine, gives its oldest batch blocks back to the arena
+         */
+        void flush (cache& c) {
+            {
+            std::lock_guard<std::mutex> g(lock);
+            for (int i = 0; i != batch; ++i) {
+                owner[offset(c.blocks[i]) / sizeof(int)] = shared;}
+            arena.deallocate_batch(c.blocks, batch, objects(1));
+            }
+            for (int i = batch; i != c.count; ++i) {
+                c.blocks[i - batch] = c.blocks[i];}
+            c.count -= batch;}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * O(1) in space
+         * O(N) in time, to mark every block shared
+         */
+        ConcurrentAllocator () {
+            for (std::size_t i = 0; i != sizeof(owner); ++i) {
+                owner[i] = shared;}}
+
+        ConcurrentAllocator             (const ConcurrentAllocator&) = delete;
+        ConcurrentAllocator& operator = (const ConcurrentAllocator&) = delete;
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * O(1) in space
+         * O(1) in time for a single object, amortized over the refills
+         * before giving up, takes back the blocks cached for threads that have exited
+         * throw a bad_alloc exception, if the arena can't satisfy the request
+         */
+        pointer allocate (size_type n) {
+            if (n == 0) {
+                return nullptr;}
+            const int t = allocator_thread_id();
+            if (n != 1 || t == -1) {
+                std::lock_guard<std::mutex> g(lock);
+                const pointer p = arena.try_allocate(objects(n));
+                if (p != nullptr) {
+                    return p;}
+                reclaim();
+                return arena.allocate(objects(n));}
+            cache& c = caches[t];
+            if (c.count == 0) {
+                refill(c, t);
+                if (c.count == 0) {
+                    throw std::bad_alloc();}}
+            const pointer p = c.blocks[--c.count];
+            owner[offset(p) / sizeof(int)] = t;
+            return p;}
+
+        // ---------
+        // construct
+        // ---------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        void construct (pointer p, const_reference v) {
+            new (p) T(v);}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(1) in time for a single object, amortized over the flushes
+         * a single object goes back to the magazine it came from, through the owner's inbox if that
+         * isn't the calling thread's
+         * cached blocks only meet the arena's sentinel checks when they're flushed, but a block that's
+         * already cached can't be freed again
+         * throw an invalid_argument exception, if p is outside the arena or already freed
+         */
+        void deallocate (pointer p, size_type n) {
+            const int o = offset(p);
+            if (o < 0 || o >= (int)sizeof(arena_type)) {
+                throw std::invalid_argument("Pointer p is out of bounds");}
+            const int u = (n == 1) ? owner[o / sizeof(int)] : shared;
+            if (u == shared) {
+                std::lock_guard<std::mutex> g(lock);
+                arena.deallocate(p, objects(n));
+                return;}
+            if (u & cached) {
+                throw std::invalid_argument("Pointer p is invalid");}
+            owner[o / sizeof(int)] = u | cached;
+            if (u != allocator_thread_id()) {
+                std::atomic<int>& inbox = caches[u].inbox;
+                int h = inbox.load(std::memory_order_relaxed);
+                do {
+                    next(p) = h;}
+                while (!inbox.compare_exchange_weak(h, o, std::memory_order_release, std::memory_order_relaxed));
+                return;}
+            cache& c = caches[u];
+            if (c.count == magazine) {
+                flush(c);}
+            c.blocks[c.count++] = p;}
+
+        // -------
+        // destroy
+        // -------
+
+        /**
+         * O(1) in space
+         * O(1) in time
+         */
+        void destroy (pointer p) {
+            p->~T();}
+
+        // ----------
+        // check_heap
+        // ----------
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * runs the arena's check_heap() under the mutex
+         * cached blocks are allocated as far as the arena is concerned
+         */
+        bool check_heap () {
+            std::lock_guard<std::mutex> g(lock);
+            return arena.check_heap();}
+
+        // -----
+        // stats
+        // -----
+
+        /**
+         * O(1) in space
+         * O(n) in time
+         * the arena's stats() under the mutex
+         * cached blocks count as allocated, and a single object taken from or given back to a
+         * magazine isn't counted until its batch moves
+         */
+        allocator_stats stats () {
+            std::lock_guard<std::mutex> g(lock);
+            return arena.stats();}};
+
+#endif // ConcurrentAllocator_h
@@ -8,13 +8,25 @@
 // includes
 // --------
 
+#include <cstdint>   // uintptr_t
 #include <cstring>   // strcmp
 #include <algorithm> // count
+#include <list>      // list
+#include <map>       // map
 #include <memory>    // allocator
+#include <memory_resource> // pmr
+#include <sstream>   // ostringstream
+#include <thread>    // thread
+#include <vector>    // vector
 
 #include "gtest/gtest.h"
 
+#define ALLOCATOR_STATS 1 // the stats_ tests check the counters
+
 #include "Allocator.h"
+#include "ArenaResource.h"
+#include "ChunkedAllocator.h"
+#include "ConcurrentAllocator.h"
 
 // --------------
 // TestAllocator1
@@ -36,7 +48,20 @@ typedef testing::Types<
             std::allocator<int>,
             std::allocator<double>,
             Allocator<int,    100>,
-            Allocator<double, 100> >
+            Allocator<double, 100>,
+            Allocator<int,    100, segregated_fit>,
+            Allocator<double, 100, segregated_fit>,
+            ConcurrentAllocator<int,    100>,
+            ConcurrentAllocator<double, 100>,
+            Allocator<double, 1000, first_fit,      check_full, 64>,
+            Allocator<double, 1000, segregated_fit, check_full, 16>,
+            Allocator<int,    100,  next_fit>,
+            Allocator<double, 100,  best_fit<> >,
+            ChunkedAllocator<int,    1000>,
+            ChunkedAllocator<double, 1000, first_fit>,
+            Allocator<int,    100,  first_fit, check_none>,
+            Allocator<int,    100,  monotonic>,
+            Allocator<double, 100,  monotonic> >
         my_types_1;
 
 TYPED_TEST_CASE(TestAllocator1, my_types_1);
@@ -52,6 +77,7 @@ TYPED_TEST(TestAllocator1, test_1) {
     const value_type     v = 2;
     const pointer        p = x.allocate(s);
     if (p != nullptr) {
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) % alignof(value_type), 0u);
         x.construct(p, v);
         ASSERT_EQ(v, *p);
         x.destroy(p);
@@ -198,9 +224,10 @@ TEST(TestAllocator2, default_constructor_smallest) {
 }
 
 TEST(TestAllocator2, default_constructor_odd) {
+    //blocks are whole multiples of alignof(int), the odd byte at the end isn't used
     const Allocator<int, 13> x;
-    ASSERT_EQ(x[0], 5);
-    ASSERT_EQ(x[9], 5);
+    ASSERT_EQ(x[0], 4);
+    ASSERT_EQ(x[8], 4);
 }
 
 TEST(TestAllocator2, default_constructor_bad_alloc) {
@@ -366,6 +393,28 @@ TEST(TestAllocator2, allocate_first_fit_2) { //allocates at deallocated address
     ASSERT_EQ (y[96], -16);
     }
 
+TEST(TestAllocator2, try_allocate_1) {
+    Allocator<int, 100> x;
+    ASSERT_EQ (x.try_allocate(0), nullptr);
+    ASSERT_EQ (x.try_allocate(26), nullptr);
+    int* p = x.try_allocate(22);
+    ASSERT_NE (p, nullptr);
+    ASSERT_EQ (x.try_allocate(1), nullptr);
+    x.deallocate(p, 22);
+    ASSERT_EQ (x.try_allocate(22), p);
+}
+
+TEST(TestAllocator2, try_allocate_2) {
+    Allocator<int, 100, fixed_pool> x;
+    ASSERT_EQ (x.try_allocate(2), nullptr);
+    while (x.try_allocate(1) != nullptr) {}
+    Allocator<int, 100, monotonic> y;
+    ASSERT_NE (y.try_allocate(20), nullptr);
+    ASSERT_EQ (y.try_allocate(20), nullptr);
+    ASSERT_TRUE(x.check_heap());
+    ASSERT_TRUE(y.check_heap());
+}
+
 /**
  * Tests the deallocate function 
  */
@@ -602,7 +651,7 @@ TEST(TestAllocator2, valid_2) {
 
 TEST(TestAllocator2, valid_3) {
     try{
-        Allocator<double, 16> x;
+        Allocator<double, 20> x; //the first sentinel sits at 4 so the payload is 8-aligned
         double* q = x.allocate(1);
         int* p = reinterpret_cast<int*>(&q[0]);
         x.deallocate(q, 1);
@@ -630,6 +679,1393 @@ TEST(TestAllocator2, valid_4) {
     }
 }
 
+/**
+ * Tests the segregated_fit free lists
+ */
+
+TEST(TestAllocator2, segregated_allocate_1) {
+    //a block has to be big enough to hold the two links once it's freed
+    Allocator<int, 100, segregated_fit> x;
+    const Allocator<int, 100, segregated_fit>& y = x;
+    int* p = x.allocate(1);
+    ASSERT_EQ (p, &y[4]);
+    ASSERT_EQ (y[0], -8);
+    ASSERT_EQ (y[12], -8);
+    ASSERT_EQ (y[16], 76);
+    ASSERT_EQ (y[96], 76);
+}
+
+TEST(TestAllocator2, segregated_allocate_2) {
+    Allocator<int, 100, segregated_fit> x;
+    const Allocator<int, 100, segregated_fit>& y = x;
+    x.allocate(3);
+    int* k = x.allocate(3);
+    x.allocate(3);
+    x.deallocate(k, 3);
+    int* b = x.allocate(3);
+    ASSERT_EQ (b, k);
+    ASSERT_EQ (y[20], -12);
+    ASSERT_EQ (y[36], -12);
+    ASSERT_EQ (y[60], 32);
+    ASSERT_EQ (y[96], 32);
+}
+
+TEST(TestAllocator2, segregated_allocate_size_class) {
+    //the large request skips the small free block in front of it
+    Allocator<int, 200, segregated_fit> x;
+    const Allocator<int, 200, segregated_fit>& y = x;
+    int* p = x.allocate(2);
+    x.allocate(1);
+    int* k = x.allocate(10);
+    x.allocate(1);
+    x.deallocate(p, 2);
+    x.deallocate(k, 10);
+    int* b = x.allocate(9);
+    ASSERT_EQ (b, k);
+    ASSERT_EQ (y[0], 8);
+    ASSERT_EQ (y[12], 8);
+}
+
+TEST(TestAllocator2, segregated_deallocate_coalesce_both_sides) {
+    Allocator<int, 100, segregated_fit> x;
+    const Allocator<int, 100, segregated_fit>& y = x;
+    int* p = x.allocate(2);
+    int* k = x.allocate(3);
+    int* l = x.allocate(2);
+    x.deallocate(p, 2);
+    x.deallocate(l, 2);
+    x.deallocate(k, 3);
+    ASSERT_EQ(y[0], 92);
+    ASSERT_EQ(y[96], 92);
+    ASSERT_EQ(x.allocate(23), &y[4]);
+}
+
+TEST(TestAllocator2, segregated_bad_alloc) {
+    try {
+    Allocator<int, 100, segregated_fit> x;
+    x.allocate(4);
+    x.allocate(2);
+    x.allocate(5);
+    x.allocate(7);
+    ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+TEST(TestAllocator2, segregated_default_constructor_bad_alloc) {
+    try {
+    const Allocator<char, 15, segregated_fit> x; //no room for the links
+    ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+/**
+ * Tests the fixed_pool specialization
+ */
+
+TEST(TestAllocator2, pool_allocate_1) {
+    Allocator<double, 100, fixed_pool> x;
+    double* p = x.allocate(1);
+    double* q = x.allocate(1);
+    ASSERT_EQ (q, p + 1);
+    x.construct(q, 7);
+    ASSERT_EQ (*q, 7);
+    x.destroy(q);
+}
+
+TEST(TestAllocator2, pool_allocate_2) {
+    //a slot is never smaller than an int so it can hold the link
+    Allocator<char, 100, fixed_pool> x;
+    char* p = x.allocate(1);
+    char* q = x.allocate(1);
+    ASSERT_EQ (q, p + sizeof(int));
+}
+
+TEST(TestAllocator2, pool_allocate_reuse) {
+    //freed slots are handed out again last in, first out
+    Allocator<int, 100, fixed_pool> x;
+    int* p = x.allocate(1);
+    int* q = x.allocate(1);
+    x.allocate(1);
+    x.deallocate(p, 1);
+    x.deallocate(q, 1);
+    ASSERT_EQ (x.allocate(1), q);
+    ASSERT_EQ (x.allocate(1), p);
+}
+
+TEST(TestAllocator2, pool_allocate_zero) {
+    Allocator<int, 100, fixed_pool> x;
+    ASSERT_EQ (x.allocate(0), nullptr);
+}
+
+TEST(TestAllocator2, pool_bad_alloc_1) {
+    try {
+    Allocator<int, 8, fixed_pool> x;
+    x.allocate(1);
+    x.allocate(1);
+    x.allocate(1);
+    ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+TEST(TestAllocator2, pool_bad_alloc_2) {
+    try {
+    Allocator<int, 100, fixed_pool> x;
+    x.allocate(2);
+    ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+TEST(TestAllocator2, pool_bad_alloc_3) {
+    try {
+    const Allocator<double, 7, fixed_pool> x;
+    ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+TEST(TestAllocator2, pool_deallocate_invalid_1) {
+    Allocator<int, 100, fixed_pool> x;
+    int* p = x.allocate(1);
+    try {
+        x.deallocate(reinterpret_cast<int*>(reinterpret_cast<char*>(p) + 1), 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is invalid"), 0); 
+    }
+}
+
+TEST(TestAllocator2, pool_deallocate_invalid_2) {
+    //double free
+    Allocator<int, 100, fixed_pool> x;
+    int* p = x.allocate(1);
+    x.allocate(1);
+    x.deallocate(p, 1);
+    try {
+        x.deallocate(p, 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is invalid"), 0); 
+    }
+}
+
+TEST(TestAllocator2, pool_deallocate_invalid_3) {
+    Allocator<int, 100, fixed_pool> x;
+    int* p = x.allocate(1);
+    try {
+        x.deallocate(p + 25, 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is out of bounds"), 0); 
+    }
+}
+
+TEST(TestAllocator2, pool_empty) {
+    Allocator<int, 100, fixed_pool> x;
+    ASSERT_TRUE(x.empty());
+    int* v[3];
+    x.allocate_batch(1, 3, v);
+    int* p = x.allocate(1);
+    ASSERT_FALSE(x.empty());
+    x.deallocate_batch(v, 3, 1);
+    ASSERT_FALSE(x.empty());
+    x.deallocate(p, 1);
+    ASSERT_TRUE(x.empty());
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, pool_valid) {
+    try{
+        Allocator<int, 100, fixed_pool> x;
+        int* p = x.allocate(1);
+        x.deallocate(p, 1);
+        p[0] = 3; //the free slot now links to a slot that was never handed out
+        x.check_heap();
+        ASSERT_TRUE(false);
+    }
+    catch(const std::logic_error& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Invalid free slot"), 0); 
+    }
+}
+
+/**
+ * Tests the check levels and check_heap
+ */
+
+TEST(TestAllocator2, check_local_allocate) {
+    //the new block's neighbour has a bad sentinel
+    try{
+        Allocator<int, 100, first_fit, check_local> x;
+        int* p = x.allocate(2);
+        int* q = x.allocate(2);
+        x.deallocate(p, 2);
+        q[2] = 3;
+        x.allocate(2);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::logic_error& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Sentinels don't match"), 0); 
+    }
+}
+
+TEST(TestAllocator2, check_local_deallocate) {
+    try{
+        Allocator<int, 100, first_fit, check_local> x;
+        int* p = x.allocate(2);
+        int* q = x.allocate(2);
+        x.allocate(2);
+        q[2] = 3;
+        x.deallocate(p, 2);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::logic_error& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Sentinels don't match"), 0); 
+    }
+}
+
+TEST(TestAllocator2, check_local_destroy) {
+    //destroy can't find its block without a walk, so check_local leaves it alone
+    Allocator<int, 12, first_fit, check_local> x;
+    int* p = x.allocate(1);
+    p[-1] = 0;
+    x.destroy(p);
+    try{
+        x.check_heap();
+        ASSERT_TRUE(false);
+    }
+    catch(const std::logic_error& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Invalid sentinal value"), 0); 
+    }
+}
+
+TEST(TestAllocator2, check_none) {
+    Allocator<int, 100, first_fit, check_none> x;
+    int* p = x.allocate(1);
+    p[1] = 1;
+    x.allocate(1);
+    x.destroy(p);
+    try{
+        x.check_heap();
+        ASSERT_TRUE(false);
+    }
+    catch(const std::logic_error& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Sentinels don't match"), 0); 
+    }
+}
+
+TEST(TestAllocator2, check_heap) {
+    Allocator<int, 100, segregated_fit, check_none> x;
+    int* p = x.allocate(3);
+    x.allocate(5);
+    x.deallocate(p, 3);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, pool_check_local) {
+    try{
+        Allocator<int, 100, fixed_pool, check_local> x;
+        int* p = x.allocate(1);
+        x.deallocate(p, 1);
+        p[0] = 3;
+        x.allocate(1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::logic_error& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Out of bounds"), 0); 
+    }
+}
+
+TEST(TestAllocator2, pool_check_heap) {
+    Allocator<int, 100, fixed_pool, check_none> x;
+    int* p = x.allocate(1);
+    x.deallocate(p, 1);
+    p[0] = 3;
+    try{
+        x.check_heap();
+        ASSERT_TRUE(false);
+    }
+    catch(const std::logic_error& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Invalid free slot"), 0); 
+    }
+}
+
+/**
+ * Tests ConcurrentAllocator
+ */
+
+TEST(TestAllocator2, concurrent_allocate_reuse) {
+    //a freed single object comes straight back out of the thread's magazine
+    ConcurrentAllocator<int, 1000> x;
+    int* p = x.allocate(1);
+    x.deallocate(p, 1);
+    ASSERT_EQ (x.allocate(1), p);
+}
+
+TEST(TestAllocator2, concurrent_allocate_bad_alloc) {
+    try {
+    ConcurrentAllocator<int, 100> x;
+    x.allocate(24);
+    ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+TEST(TestAllocator2, concurrent_deallocate_invalid) {
+    ConcurrentAllocator<int, 100> x;
+    int i;
+    try {
+        x.deallocate(&i, 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is out of bounds"), 0); 
+    }
+}
+
+TEST(TestAllocator2, concurrent_double_free) {
+    //a block already back in the magazine can't be freed again, by its owner or by another thread
+    ConcurrentAllocator<int, 1000> x;
+    int* p = x.allocate(1);
+    x.deallocate(p, 1);
+    try {
+        x.deallocate(p, 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is invalid"), 0); 
+    }
+    int* q = x.allocate(1);
+    ASSERT_EQ (q, p);
+    ASSERT_NE (x.allocate(1), q);
+    x.deallocate(q, 1);
+    bool thrown = false;
+    std::thread t([&x, &thrown, q] () {
+        try {
+            x.deallocate(q, 1);}
+        catch (const std::invalid_argument&) {
+            thrown = true;}});
+    t.join();
+    ASSERT_TRUE(thrown);
+}
+
+TEST(TestAllocator2, concurrent_cross_thread) {
+    //blocks freed by another thread go back to the owner's magazine
+    ConcurrentAllocator<int, 1000> x;
+    std::vector<int*> v;
+    try {
+        while (true) {
+            v.push_back(x.allocate(1));}}
+    catch (const std::bad_alloc&) {}
+    const std::size_t n = v.size();
+    ASSERT_GT (n, 0u);
+    std::thread t([&x, &v] () {
+        for (std::size_t i = 0; i != v.size(); ++i) {
+            x.deallocate(v[i], 1);}});
+    t.join();
+    v.clear();
+    try {
+        while (true) {
+            v.push_back(x.allocate(1));}}
+    catch (const std::bad_alloc&) {}
+    ASSERT_EQ (v.size(), n);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, concurrent_reclaim) {
+    //blocks freed to a thread that has exited go back to the arena once it runs out
+    ConcurrentAllocator<int, 1000> x;
+    x.deallocate(x.allocate(1), 1);
+    std::vector<int*> v;
+    std::thread t([&x, &v] () {
+        try {
+            while (true) {
+                v.push_back(x.allocate(1));}}
+        catch (const std::bad_alloc&) {}});
+    t.join();
+    ASSERT_GT (v.size(), 0u);
+    for (std::size_t i = 0; i != v.size(); ++i) {
+        x.deallocate(v[i], 1);}
+    ASSERT_NE (x.allocate(100), nullptr);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, concurrent_reclaim_magazine) {
+    //and so do they when the thread that runs out allocates single objects
+    ConcurrentAllocator<int, 1000> x;
+    std::vector<int*> v;
+    std::thread t([&x, &v] () {
+        try {
+            while (true) {
+                v.push_back(x.allocate(1));}}
+        catch (const std::bad_alloc&) {}});
+    t.join();
+    for (std::size_t i = 0; i != v.size(); ++i) {
+        x.deallocate(v[i], 1);}
+    const std::size_t n = v.size();
+    v.clear();
+    try {
+        while (true) {
+            v.push_back(x.allocate(1));}}
+    catch (const std::bad_alloc&) {}
+    ASSERT_EQ (v.size(), n);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, concurrent_threads) {
+    //each thread frees half its blocks itself and hands the other half to its neighbour
+    ConcurrentAllocator<double, 100000, segregated_fit, check_local> x;
+    const int k = 4;
+    const int m = 500;
+    std::vector<std::vector<double*> > v(k);
+    std::vector<std::thread> t;
+    for (int i = 0; i != k; ++i) {
+        t.push_back(std::thread([&x, &v, i] () {
+            for (int j = 0; j != m; ++j) {
+                double* p = x.allocate(1);
+                x.construct(p, i);
+                if (j % 2 == 0) {
+                    v[i].push_back(p);}
+                else {
+                    ASSERT_EQ (*p, i);
+                    x.destroy(p);
+                    x.deallocate(p, 1);}}}));}
+    for (int i = 0; i != k; ++i) {
+        t[i].join();}
+    for (int i = 0; i != k; ++i) {
+        t[i] = std::thread([&x, &v, i] () {
+            const std::vector<double*>& w = v[(i + 1) % k];
+            for (std::size_t j = 0; j != w.size(); ++j) {
+                x.destroy(w[j]);
+                x.deallocate(w[j], 1);}});}
+    for (int i = 0; i != k; ++i) {
+        t[i].join();}
+    ASSERT_TRUE(x.check_heap());
+}
+
+/**
+ * Tests alignment
+ */
+
+TEST(TestAllocator2, aligned_default_constructor) {
+    //the first sentinel sits 4 bytes before the first 8 byte boundary, the last 4 bytes can't be used
+    const Allocator<double, 100> x;
+    ASSERT_EQ(x[4], 88);
+    ASSERT_EQ(x[96], 88);
+}
+
+TEST(TestAllocator2, aligned_default_constructor_bad_alloc) {
+    try {
+    const Allocator<double, 16> x; //no room left for the padding
+    ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+TEST(TestAllocator2, aligned_allocate_1) {
+    Allocator<double, 100> x;
+    const Allocator<double, 100>& y = x;
+    double* p = x.allocate(1);
+    double* q = x.allocate(2);
+    ASSERT_EQ (reinterpret_cast<std::uintptr_t>(p) % 8, 0u);
+    ASSERT_EQ (reinterpret_cast<std::uintptr_t>(q) % 8, 0u);
+    ASSERT_EQ (p, reinterpret_cast<const double*>(&y[8]));
+    ASSERT_EQ (q, reinterpret_cast<const double*>(&y[24]));
+    ASSERT_EQ (y[4], -8);
+    ASSERT_EQ (y[16], -8);
+    ASSERT_EQ (y[20], -16);
+    ASSERT_EQ (y[40], -16);
+    ASSERT_EQ (y[44], 48);
+    ASSERT_EQ (y[96], 48);
+}
+
+TEST(TestAllocator2, aligned_allocate_2) {
+    //the padding that keeps the next block aligned belongs to the payload
+    Allocator<char, 200, first_fit, check_full, 16> x;
+    const Allocator<char, 200, first_fit, check_full, 16>& y = x;
+    char* p = x.allocate(1);
+    char* q = x.allocate(9);
+    ASSERT_EQ (p, reinterpret_cast<const char*>(&y[16]));
+    ASSERT_EQ (q, reinterpret_cast<const char*>(&y[32]));
+    ASSERT_EQ (y[12], -8);
+    ASSERT_EQ (y[24], -8);
+    ASSERT_EQ (y[28], -24);
+    ASSERT_EQ (y[56], -24);
+}
+
+TEST(TestAllocator2, aligned_small) {
+    //alignments up to sizeof(int) are honoured too
+    Allocator<char, 100, first_fit, check_full, 4> x;
+    Allocator<char, 100, first_fit, check_full, 2> y;
+    for (int i = 1; i != 6; ++i) {
+        ASSERT_EQ (reinterpret_cast<std::uintptr_t>(x.allocate(i)) % 4, 0u);
+        ASSERT_EQ (reinterpret_cast<std::uintptr_t>(y.allocate(i)) % 2, 0u);}
+    ASSERT_TRUE(x.check_heap());
+    ASSERT_TRUE(y.check_heap());
+}
+
+TEST(TestAllocator2, aligned_cache_line) {
+    Allocator<char, 1000, first_fit, check_full, 64> x;
+    const Allocator<char, 1000, first_fit, check_full, 64>& y = x;
+    char* p = x.allocate(1);
+    char* q = x.allocate(3);
+    char* r = x.allocate(70);
+    ASSERT_EQ (reinterpret_cast<std::uintptr_t>(p) % 64, 0u);
+    ASSERT_EQ (q, p + 64);
+    ASSERT_EQ (r, q + 64);
+    x.deallocate(q, 3);
+    ASSERT_EQ (x.allocate(50), q);
+    x.deallocate(p, 1);
+    x.deallocate(q, 50);
+    x.deallocate(r, 70);
+    ASSERT_EQ (y[60], 888);
+    ASSERT_EQ (y[952], 888);
+}
+
+TEST(TestAllocator2, aligned_segregated) {
+    Allocator<double, 1000, segregated_fit, check_full, 32> x;
+    std::vector<double*> v;
+    for (int i = 1; i != 8; ++i) {
+        v.push_back(x.allocate(i));
+        ASSERT_EQ (reinterpret_cast<std::uintptr_t>(v.back()) % 32, 0u);}
+    for (std::size_t i = 0; i < v.size(); i += 2) {
+        x.deallocate(v[i], i + 1);}
+    double* p = x.allocate(1);
+    ASSERT_EQ (reinterpret_cast<std::uintptr_t>(p) % 32, 0u);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, aligned_pool) {
+    Allocator<int, 1000, fixed_pool, check_full, 64> x;
+    int* p = x.allocate(1);
+    int* q = x.allocate(1);
+    ASSERT_EQ (reinterpret_cast<std::uintptr_t>(p) % 64, 0u);
+    ASSERT_EQ (q, p + 16);
+}
+
+/**
+ * Tests allocate_batch and deallocate_batch
+ */
+
+TEST(TestAllocator2, allocate_batch_1) {
+    Allocator<int, 100> x;
+    const Allocator<int, 100>& y = x;
+    int* b[4];
+    x.allocate_batch(3, 4, b);
+    ASSERT_EQ (b[0], &y[4]);
+    ASSERT_EQ (b[1], &y[24]);
+    ASSERT_EQ (b[2], &y[44]);
+    ASSERT_EQ (b[3], &y[64]);
+    ASSERT_EQ (y[80], 12);
+    ASSERT_EQ (y[96], 12);
+}
+
+TEST(TestAllocator2, allocate_batch_first_fit) {
+    //the holes are filled in address order before the free space at the end
+    Allocator<int, 100> x;
+    const Allocator<int, 100>& y = x;
+    int* p = x.allocate(3);
+    x.allocate(3);
+    int* q = x.allocate(3);
+    x.allocate(3);
+    x.deallocate(p, 3);
+    x.deallocate(q, 3);
+    int* b[3];
+    x.allocate_batch(3, 3, b);
+    ASSERT_EQ (b[0], p);
+    ASSERT_EQ (b[1], q);
+    ASSERT_EQ (b[2], &y[84]);
+}
+
+TEST(TestAllocator2, allocate_batch_bad_alloc) {
+    //the blocks that did fit are given back
+    Allocator<int, 100> x;
+    const Allocator<int, 100>& y = x;
+    int* b[5];
+    try {
+        x.allocate_batch(5, 5, b);
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+    ASSERT_EQ (y[0], 92);
+    ASSERT_EQ (y[96], 92);
+}
+
+TEST(TestAllocator2, deallocate_batch_1) {
+    //pointers in any order, touching blocks coalesce into one
+    Allocator<int, 100> x;
+    const Allocator<int, 100>& y = x;
+    int* b[4];
+    x.allocate_batch(3, 4, b);
+    int* c[4] = {b[3], b[1], b[0], b[2]};
+    x.deallocate_batch(c, 4, 3);
+    ASSERT_EQ (c[0], b[0]);
+    ASSERT_EQ (c[3], b[3]);
+    ASSERT_EQ (y[0], 92);
+    ASSERT_EQ (y[96], 92);
+}
+
+TEST(TestAllocator2, deallocate_batch_2) {
+    Allocator<int, 100> x;
+    const Allocator<int, 100>& y = x;
+    int* b[4];
+    x.allocate_batch(3, 4, b);
+    int* c[2] = {b[2], b[0]};
+    x.deallocate_batch(c, 2, 3);
+    ASSERT_EQ (y[0], 12);
+    ASSERT_EQ (y[16], 12);
+    ASSERT_EQ (y[20], -12);
+    ASSERT_EQ (y[40], 12);
+    ASSERT_EQ (y[56], 12);
+    ASSERT_EQ (y[60], -12);
+}
+
+TEST(TestAllocator2, deallocate_batch_invalid_1) {
+    //one bad pointer and nothing is freed
+    Allocator<int, 100> x;
+    const Allocator<int, 100>& y = x;
+    int* b[3];
+    x.allocate_batch(3, 3, b);
+    int* c[3] = {b[0], b[1] + 1, b[2]};
+    try {
+        x.deallocate_batch(c, 3, 3);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is invalid"), 0); 
+    }
+    ASSERT_EQ (y[0], -12);
+    ASSERT_EQ (y[20], -12);
+    ASSERT_EQ (y[40], -12);
+}
+
+TEST(TestAllocator2, deallocate_batch_invalid_2) {
+    Allocator<int, 100> x;
+    int* b[2];
+    x.allocate_batch(3, 2, b);
+    int* c[3] = {b[0], b[1], b[0]};
+    try {
+        x.deallocate_batch(c, 3, 3);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is invalid"), 0); 
+    }
+}
+
+TEST(TestAllocator2, batch_segregated) {
+    Allocator<double, 1000, segregated_fit> x;
+    double* b[10];
+    x.allocate_batch(2, 10, b);
+    for (int i = 0; i != 10; i += 2) {
+        x.deallocate(b[i], 2);}
+    x.allocate_batch(2, 5, b);
+    x.deallocate_batch(b, 5, 2);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, batch_pool) {
+    //freed in a batch, the slots come back in address order
+    Allocator<int, 16, fixed_pool> x;
+    int* b[4];
+    x.allocate_batch(1, 4, b);
+    int* c[3] = {b[3], b[0], b[2]};
+    x.deallocate_batch(c, 3, 1);
+    ASSERT_EQ (x.allocate(1), b[0]);
+    ASSERT_EQ (x.allocate(1), b[2]);
+    ASSERT_EQ (x.allocate(1), b[3]);
+}
+
+TEST(TestAllocator2, batch_pool_bad_alloc) {
+    Allocator<int, 16, fixed_pool> x;
+    x.allocate(1);
+    int* b[4];
+    try {
+        x.allocate_batch(1, 4, b);
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+    x.allocate_batch(1, 3, b);
+}
+
+/**
+ * Tests next_fit and best_fit
+ */
+
+TEST(TestAllocator2, next_fit_1) {
+    //the search starts after the last allocation, not at the hole in front
+    Allocator<int, 100, next_fit> x;
+    const Allocator<int, 100, next_fit>& y = x;
+    int* p = x.allocate(3);
+    x.allocate(3);
+    x.allocate(3);
+    x.deallocate(p, 3);
+    ASSERT_EQ (x.allocate(3), &y[64]);
+    ASSERT_EQ (y[0], 12);
+    ASSERT_EQ (y[60], -12);
+}
+
+TEST(TestAllocator2, next_fit_wrap) {
+    Allocator<int, 100, next_fit> x;
+    int* p = x.allocate(3);
+    x.allocate(3);
+    x.allocate(3);
+    x.allocate(3);
+    x.allocate(3);
+    x.deallocate(p, 3);
+    ASSERT_EQ (x.allocate(3), p);
+}
+
+TEST(TestAllocator2, next_fit_coalesce) {
+    //the rover was on the free block that got merged, it moves to the merged block
+    Allocator<int, 100, next_fit> x;
+    x.allocate(3);
+    x.allocate(3);
+    int* p = x.allocate(3);
+    x.deallocate(p, 3);
+    ASSERT_EQ (x.allocate(5), p);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, next_fit_batch) {
+    Allocator<int, 100, next_fit> x;
+    const Allocator<int, 100, next_fit>& y = x;
+    int* p = x.allocate(3);
+    x.allocate(3);
+    x.deallocate(p, 3);
+    int* b[4];
+    x.allocate_batch(3, 4, b);
+    ASSERT_EQ (b[0], &y[44]);
+    ASSERT_EQ (b[1], &y[64]);
+    ASSERT_EQ (b[2], &y[84]);
+    ASSERT_EQ (b[3], p);
+}
+
+TEST(TestAllocator2, best_fit_1) {
+    //the exact fit behind the bigger hole is taken
+    Allocator<int, 100, best_fit<> > x;
+    const Allocator<int, 100, best_fit<> >& y = x;
+    int* p = x.allocate(5);
+    x.allocate(1);
+    int* q = x.allocate(3);
+    x.allocate(1);
+    x.deallocate(p, 5);
+    x.deallocate(q, 3);
+    ASSERT_EQ (x.allocate(3), q);
+    ASSERT_EQ (y[0], 20);
+}
+
+TEST(TestAllocator2, best_fit_2) {
+    //the smallest hole that fits, with no exact fit
+    Allocator<int, 200, best_fit<> > x;
+    int* p = x.allocate(8);
+    x.allocate(1);
+    int* q = x.allocate(4);
+    x.allocate(1);
+    int* r = x.allocate(6);
+    x.allocate(1);
+    x.deallocate(p, 8);
+    x.deallocate(q, 4);
+    x.deallocate(r, 6);
+    ASSERT_EQ (x.allocate(5), r);
+}
+
+TEST(TestAllocator2, best_fit_limit) {
+    //stops at the first block that fits, like first_fit
+    Allocator<int, 100, best_fit<1> > x;
+    int* p = x.allocate(5);
+    x.allocate(1);
+    int* q = x.allocate(3);
+    x.allocate(1);
+    x.deallocate(p, 5);
+    x.deallocate(q, 3);
+    ASSERT_EQ (x.allocate(3), p);
+}
+
+TEST(TestAllocator2, best_fit_scan_limit) {
+    //L counts every block visited, so the exact fit past the limit isn't reached
+    Allocator<int, 100, best_fit<3> > x;
+    int* p = x.allocate(5);
+    x.allocate(1);
+    x.allocate(1);
+    int* q = x.allocate(3);
+    x.allocate(1);
+    x.deallocate(p, 5);
+    x.deallocate(q, 3);
+    const std::size_t n = x.stats().scanned;
+    ASSERT_EQ (x.allocate(3), p);
+    ASSERT_EQ (x.stats().scanned - n, 3u);
+}
+
+/**
+ * Tests stats and dump
+ */
+
+TEST(TestAllocator2, stats_counts) {
+    Allocator<int, 100> x;
+    int* p = x.allocate(1);
+    int* q = x.allocate(3);
+    x.deallocate(p, 1);
+    const allocator_stats r = x.stats();
+    ASSERT_EQ (r.allocations,   2u);
+    ASSERT_EQ (r.deallocations, 1u);
+    ASSERT_EQ (r.failures,      0u);
+    ASSERT_EQ (r.sizes[2],      1u);
+    ASSERT_EQ (r.sizes[3],      1u);
+    x.deallocate(q, 3);
+}
+
+TEST(TestAllocator2, stats_failures) {
+    Allocator<int, 100> x;
+    try {
+        x.allocate(24);}
+    catch (const std::bad_alloc&) {}
+    try {
+        x.allocate(1000);}
+    catch (const std::bad_alloc&) {}
+    ASSERT_EQ (x.try_allocate(24), nullptr);
+    ASSERT_EQ (x.stats().failures,    2u);
+    ASSERT_EQ (x.stats().allocations, 0u);
+}
+
+TEST(TestAllocator2, stats_scanned) {
+    //first_fit walks past every allocated block to get to the free one
+    Allocator<int, 100> x;
+    x.allocate(1);
+    x.allocate(1);
+    x.allocate(1);
+    const allocator_stats r = x.stats();
+    ASSERT_EQ (r.searches,    3u);
+    ASSERT_EQ (r.scanned,     6u);
+    ASSERT_EQ (r.max_scanned, 3u);
+}
+
+TEST(TestAllocator2, stats_coalesce) {
+    Allocator<int, 100> x;
+    int* p = x.allocate(1);
+    int* q = x.allocate(1);
+    int* r = x.allocate(1);
+    int* s = x.allocate(1);
+    x.deallocate(q, 1);
+    x.deallocate(p, 1);
+    x.deallocate(s, 1);
+    x.deallocate(r, 1);
+    const allocator_stats t = x.stats();
+    ASSERT_EQ (t.coalesced_back,  0u);
+    ASSERT_EQ (t.coalesced_front, 2u);
+    ASSERT_EQ (t.coalesced_both,  1u);
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(TestAllocator2, stats_batch) {
+    Allocator<int, 100, segregated_fit> x;
+    int* b[3];
+    x.allocate_batch(2, 3, b);
+    x.deallocate_batch(b, 3, 2);
+    const allocator_stats r = x.stats();
+    ASSERT_EQ (r.allocations,   3u);
+    ASSERT_EQ (r.deallocations, 3u);
+    ASSERT_EQ (r.searches,      3u);
+    ASSERT_EQ (r.sizes[3],      3u);
+}
+
+TEST(TestAllocator2, stats_heap) {
+    Allocator<int, 100> x;
+    int* p = x.allocate(2);
+    x.allocate(2);
+    x.deallocate(p, 2);
+    const allocator_stats r = x.stats();
+    ASSERT_EQ (r.blocks,         3u);
+    ASSERT_EQ (r.free_blocks,    2u);
+    ASSERT_EQ (r.bytes_live,     8u);
+    ASSERT_EQ (r.bytes_free,     68u);
+    ASSERT_EQ (r.bytes_sentinel, 24u);
+    ASSERT_EQ (r.largest_free,   60u);
+    ASSERT_DOUBLE_EQ (r.fragmentation, 1 - 60.0 / 68);
+}
+
+TEST(TestAllocator2, stats_empty) {
+    Allocator<double, 100> x;
+    const allocator_stats r = x.stats();
+    ASSERT_EQ (r.blocks,       1u);
+    ASSERT_EQ (r.largest_free, 88u);
+    ASSERT_EQ (r.fragmentation, 0);
+}
+
+TEST(TestAllocator2, dump) {
+    Allocator<int, 100> x;
+    int* p = x.allocate(2);
+    x.allocate(3);
+    x.deallocate(p, 2);
+    std::ostringstream out;
+    x.dump(out);
+    ASSERT_EQ (out.str(),
+        "       0        8 free\n"
+        "      16      -12 allocated\n"
+        "      36       56 free\n");
+}
+
+TEST(TestAllocator2, dump_corrupt) {
+    //stops at the bad block
+    Allocator<int, 100> x;
+    int* p = x.allocate(2);
+    x.allocate(2);
+    p[2] = 3;
+    std::ostringstream out;
+    x.dump(out);
+    ASSERT_EQ (out.str(),
+        "       0       -8 sentinels don't match\n");
+}
+
+TEST(TestAllocator2, dump_too_small) {
+    //a free block too small for a double stops the dump, as it stops valid()
+    Allocator<double, 100> x;
+    double* p = x.allocate(1);
+    x.allocate(1);
+    x.deallocate(p, 1);
+    reinterpret_cast<int*>(p)[-1] = 4;
+    std::ostringstream out;
+    x.dump(out);
+    ASSERT_EQ (out.str(),
+        "       4        4 block too small\n");
+}
+
+/**
+ * Tests monotonic, reset and the trusted deallocate
+ */
+
+TEST(TestAllocator2, monotonic_allocate) {
+    Allocator<int, 100, monotonic> x;
+    const Allocator<int, 100, monotonic>& y = x;
+    int* p = x.allocate(1);
+    int* q = x.allocate(3);
+    int* r = x.allocate(2);
+    ASSERT_EQ (q, p + 1);
+    ASSERT_EQ (r, q + 3);
+    ASSERT_EQ (y[0],  92);
+    ASSERT_EQ (y[96], 92);
+}
+
+TEST(TestAllocator2, monotonic_aligned) {
+    Allocator<char, 1000, monotonic, check_full, 64> x;
+    char* p = x.allocate(1);
+    char* q = x.allocate(65);
+    char* r = x.allocate(1);
+    ASSERT_EQ (reinterpret_cast<std::uintptr_t>(p) % 64, 0u);
+    ASSERT_EQ (q, p + 64);
+    ASSERT_EQ (r, q + 128);
+}
+
+TEST(TestAllocator2, monotonic_deallocate) {
+    //a free gives nothing back until reset
+    Allocator<int, 100, monotonic> x;
+    int* p = x.allocate(20);
+    x.deallocate(p, 20);
+    try {
+        x.allocate(20);
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+    x.reset();
+    ASSERT_TRUE(x.empty());
+    ASSERT_EQ (x.allocate(20), p);
+}
+
+TEST(TestAllocator2, monotonic_deallocate_invalid) {
+    Allocator<int, 100, monotonic> x;
+    int* p = x.allocate(1);
+    try {
+        x.deallocate(p + 1, 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is out of bounds"), 0); 
+    }
+}
+
+TEST(TestAllocator2, monotonic_batch) {
+    Allocator<int, 100, monotonic> x;
+    int* b[4];
+    x.allocate_batch(2, 4, b);
+    ASSERT_EQ (b[3], b[0] + 6);
+    try {
+        x.allocate_batch(2, 8, b);
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+    ASSERT_EQ (x.allocate(1), b[0] + 8);
+}
+
+TEST(TestAllocator2, monotonic_check_heap) {
+    Allocator<int, 100, monotonic, check_none> x;
+    int* p = x.allocate(23);
+    p[23] = 0;
+    try {
+        x.check_heap();
+        ASSERT_TRUE(false);
+    }
+    catch(const std::logic_error& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Sentinels don't match"), 0); 
+    }
+    x.reset();
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, reset_1) {
+    Allocator<int, 100> x;
+    const Allocator<int, 100>& y = x;
+    x.allocate(3);
+    x.allocate(5);
+    x.reset();
+    ASSERT_TRUE(x.empty());
+    ASSERT_EQ (y[0],  92);
+    ASSERT_EQ (y[96], 92);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, reset_2) {
+    //the size-class lists start over too
+    Allocator<int, 200, segregated_fit> x;
+    int* p = x.allocate(2);
+    int* q = x.allocate(2);
+    x.allocate(2);
+    x.deallocate(q, 2);
+    x.reset();
+    ASSERT_EQ (x.allocate(2), p);
+    ASSERT_EQ (x.allocate(2), q);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, trusted_deallocate) {
+    Allocator<int, 100, first_fit, check_none> x;
+    int* p = x.allocate(2);
+    int* q = x.allocate(3);
+    x.allocate(1);
+    x.deallocate_trusted(q, 3);
+    x.deallocate_trusted(p, 2);
+    ASSERT_EQ (x.stats().coalesced_front, 1u);
+    ASSERT_EQ (x.allocate(7), p);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, trusted_trailer) {
+    //a header that matches n is trusted, the trailer isn't read
+    Allocator<int, 100, first_fit, check_none> x;
+    int* p = x.allocate(2);
+    x.allocate(1);
+    p[2] = 5;
+    x.deallocate_trusted(p, 2);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, trusted_whole_block) {
+    //carve handed out the whole block, so n doesn't match and header() takes over
+    Allocator<int, 100, first_fit, check_none> x;
+    int* p = x.allocate(22);
+    x.deallocate_trusted(p, 22);
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(TestAllocator2, trusted_invalid) {
+    //n that doesn't match falls back to the full checks
+    Allocator<int, 100, first_fit, check_none> x;
+    int* p = x.allocate(2);
+    try {
+        x.deallocate_trusted(p + 1, 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is invalid"), 0); 
+    }
+}
+
+TEST(TestAllocator2, check_none_deallocate) {
+    //check_none still checks the pointer, a fake header inside a live block isn't trusted
+    Allocator<int, 100, first_fit, check_none> x;
+    int* p = x.allocate(4);
+    p[0] = -4;
+    try {
+        x.deallocate(p + 1, 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is invalid"), 0); 
+    }
+    ASSERT_TRUE(x.check_heap());
+}
+
+/**
+ * Tests ArenaResource and ArenaAllocator
+ */
+
+TEST(TestAllocator2, resource_sizes) {
+    ArenaResource<1000> r;
+    void* p = r.allocate(1);
+    void* q = r.allocate(100, 8);
+    void* s = r.allocate(0);
+    ASSERT_EQ ((std::uintptr_t)p % alignof(std::max_align_t), 0u);
+    ASSERT_EQ ((std::uintptr_t)q % alignof(std::max_align_t), 0u);
+    ASSERT_TRUE(r.check_heap());
+    r.deallocate(q, 100, 8);
+    r.deallocate(p, 1);
+    r.deallocate(s, 0);
+    ASSERT_TRUE(r.empty());
+}
+
+TEST(TestAllocator2, resource_over_aligned) {
+    ArenaResource<1000> r;
+    void* p = r.allocate(1);
+    void* q = r.allocate(24, 64);
+    void* s = r.allocate(24, 256);
+    ASSERT_EQ ((std::uintptr_t)q % 64,  0u);
+    ASSERT_EQ ((std::uintptr_t)s % 256, 0u);
+    r.deallocate(s, 24, 256);
+    r.deallocate(p, 1);
+    r.deallocate(q, 24, 64);
+    ASSERT_TRUE(r.empty());
+}
+
+TEST(TestAllocator2, resource_bad_alloc) {
+    ArenaResource<100> r;
+    try {
+        r.deallocate(r.allocate(24, 128), 24, 128);
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+    try {
+        r.deallocate(r.allocate(200), 200);
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+TEST(TestAllocator2, resource_equal) {
+    ArenaResource<100> r;
+    ArenaResource<100> s;
+    ASSERT_TRUE (r.is_equal(r));
+    ASSERT_FALSE(r.is_equal(s));
+}
+
+TEST(TestAllocator2, resource_pmr) {
+    //pmr containers of different types share one arena
+    ArenaResource<10000> r;
+    {
+    std::pmr::vector<int>      v(&r);
+    std::pmr::list<double>     l(&r);
+    std::pmr::map<int, char>   m(&r);
+    for (int i = 0; i != 50; ++i) {
+        v.push_back(i);
+        l.push_back(i);
+        m[i] = 'a';}
+    ASSERT_EQ (v.size(), 50u);
+    ASSERT_EQ (m.size(), 50u);
+    ASSERT_TRUE(r.check_heap());
+    }
+    ASSERT_TRUE(r.empty());
+}
+
+TEST(TestAllocator2, arena_allocator_containers) {
+    typedef ArenaResource<10000> resource;
+    resource r;
+    ArenaAllocator<int, resource> x(r);
+    {
+    std::vector<int, ArenaAllocator<int, resource> > v(x);
+    std::list<double, ArenaAllocator<double, resource> > l(x);
+    std::map<int, int, std::less<int>, ArenaAllocator<std::pair<const int, int>, resource> > m(x);
+    for (int i = 0; i != 50; ++i) {
+        v.push_back(i);
+        l.push_back(i);
+        m[i] = i;}
+    ASSERT_EQ (std::count(v.begin(), v.end(), 7), 1);
+    ASSERT_EQ (l.back(), 49);
+    ASSERT_EQ (m[49], 49);
+    ASSERT_FALSE(r.empty());
+    }
+    ASSERT_TRUE(r.empty());
+}
+
+TEST(TestAllocator2, arena_allocator_equal) {
+    typedef ArenaResource<1000> resource;
+    resource r;
+    resource s;
+    ArenaAllocator<int, resource> x(r);
+    ArenaAllocator<double, resource> y(x);
+    ArenaAllocator<int, resource> z(s);
+    ASSERT_TRUE (x == y);
+    ASSERT_TRUE ((x == ArenaAllocator<int, resource>(y)));
+    ASSERT_TRUE (x != z);
+    ASSERT_EQ   (y.resource(), &r);
+}
+
+TEST(TestAllocator2, arena_allocator_move) {
+    //the handle moves with the container, so the blocks stay in their arena
+    typedef ArenaResource<1000> resource;
+    resource r;
+    resource s;
+    ArenaAllocator<int, resource> x(r);
+    ArenaAllocator<int, resource> y(s);
+    std::vector<int, ArenaAllocator<int, resource> > v(10, 1, x);
+    std::vector<int, ArenaAllocator<int, resource> > w(y);
+    w = std::move(v);
+    ASSERT_EQ (w.get_allocator().resource(), &r);
+    ASSERT_TRUE(s.empty());
+    w.clear();
+    w.shrink_to_fit();
+    ASSERT_TRUE(r.empty());
+}
+
+/**
+ * Tests ChunkedAllocator
+ */
+
+TEST(TestAllocator2, chunked_grow) {
+    //a request the first chunk can't hold maps a second one
+    ChunkedAllocator<int, 100> x;
+    ASSERT_EQ (x.chunks(), 1u);
+    int* p = x.allocate(20);
+    int* q = x.allocate(20);
+    ASSERT_EQ (x.chunks(), 2u);
+    ASSERT_NE (p, q);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, chunked_capacity) {
+    ChunkedAllocator<int, 100> x(250);
+    ASSERT_EQ (x.chunks(), 3u);
+    ASSERT_EQ (x.mapped() % sysconf(_SC_PAGESIZE), 0u);
+}
+
+TEST(TestAllocator2, chunked_release) {
+    //an emptied chunk past the high water mark goes back to the OS
+    ChunkedAllocator<int, 100> x;
+    int* p = x.allocate(20);
+    int* q = x.allocate(20);
+    ASSERT_EQ (x.chunks(), 2u);
+    x.deallocate(q, 20);
+    ASSERT_EQ (x.chunks(), 1u);
+    x.deallocate(p, 20);
+    ASSERT_EQ (x.chunks(), 1u);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, chunked_high_water) {
+    //emptied chunks under the high water mark stay mapped and get reused
+    ChunkedAllocator<int, 100> x(100, 1 << 20);
+    int* p = x.allocate(20);
+    int* q = x.allocate(20);
+    x.deallocate(q, 20);
+    x.deallocate(p, 20);
+    ASSERT_EQ (x.chunks(), 2u);
+    x.allocate(20);
+    x.allocate(20);
+    ASSERT_EQ (x.chunks(), 2u);
+}
+
+TEST(TestAllocator2, chunked_bad_alloc) {
+    //no request can be bigger than a chunk, and the chunk mapped for it is given back
+    ChunkedAllocator<int, 100> x;
+    try {
+        x.allocate(24);
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+    ASSERT_EQ (x.chunks(), 1u);
+}
+
+TEST(TestAllocator2, chunked_oversize) {
+    //more objects than a chunk holds is refused before anything is mapped
+    ChunkedAllocator<int, 100> x;
+    const std::size_t m = x.mapped();
+    try {
+        x.allocate(26);
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+    ASSERT_EQ (x.mapped(), m);
+}
+
+TEST(TestAllocator2, chunked_probe) {
+    //full chunks are skipped, a chunk with room is found without mapping another
+    ChunkedAllocator<int, 100> x(300);
+    int* p = x.allocate(20);
+    x.allocate(20);
+    x.allocate(20);
+    x.deallocate(p, 20);
+    ASSERT_EQ (x.allocate(20), p);
+    ASSERT_EQ (x.chunks(), 3u);
+}
+
+TEST(TestAllocator2, chunked_pool) {
+    //fixed_pool chunks work too, an emptied one is given back
+    ChunkedAllocator<int, 16, fixed_pool> x;
+    int* p = x.allocate(1);
+    int* q = x.allocate(1);
+    int* r = x.allocate(1);
+    int* s = x.allocate(1);
+    int* t = x.allocate(1);
+    ASSERT_EQ (x.chunks(), 2u);
+    x.deallocate(t, 1);
+    ASSERT_EQ (x.chunks(), 1u);
+    x.deallocate(p, 1);
+    x.deallocate(q, 1);
+    x.deallocate(r, 1);
+    x.deallocate(s, 1);
+    ASSERT_TRUE(x.check_heap());
+}
+
+TEST(TestAllocator2, chunked_too_small) {
+    //a chunk that can't be built throws, and its mapping goes back
+    try {
+        ChunkedAllocator<int, 8> x;
+        ASSERT_TRUE(false);}
+    catch(const std::bad_alloc& e){ 
+        ASSERT_EQ(strcmp(e.what(), "std::bad_alloc"), 0); 
+    }
+}
+
+TEST(TestAllocator2, chunked_deallocate_invalid) {
+    ChunkedAllocator<int, 100> x;
+    int i;
+    try {
+        x.deallocate(&i, 1);
+        ASSERT_TRUE(false);
+    }
+    catch(const std::invalid_argument& e){ 
+        ASSERT_EQ(strcmp(e.what(), "Pointer p is out of bounds"), 0); 
+    }
+}
+
+TEST(TestAllocator2, chunked_move) {
+    ChunkedAllocator<int, 100> x;
+    int* p = x.allocate(20);
+    x.allocate(20);
+    ChunkedAllocator<int, 100> y(std::move(x));
+    ASSERT_EQ (x.chunks(), 0u);
+    ASSERT_EQ (y.chunks(), 2u);
+    y.deallocate(p, 20);
+    ASSERT_TRUE(y.check_heap());
+}
+
 // --------------
 // TestAllocator3
 // --------------
@@ -647,7 +2083,8 @@ struct TestAllocator3 : testing::Test {
 
 typedef testing::Types<
             Allocator<char,    100>,
-            Allocator<double, 100> >
+            Allocator<double, 100>,
+            Allocator<char,   100, segregated_fit> >
         my_types_2;
 
 TYPED_TEST_CASE(TestAllocator3, my_types_2);